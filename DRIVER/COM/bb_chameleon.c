@@ -56,6 +56,30 @@
  * Note: If one of the modules specified with DEVICE_ID_<n> could not be
  * found, only this slot is unusuable.
  *
+ *  Alternatively, the whole slot assignment can be given with the single
+ *  SLOT_MAP key. Then all DEVICE_ID(V2)_<n> and GROUP_<n> keys are ignored.
+ *  Each entry consists of 6 bytes:
+ *
+ *     slot, devId MSB, devId LSB, instance/index, group, member
+ *
+ *  For group 0, instance is the V2 instance (as in DEVICE_IDV2_<n>) and
+ *  member must be 0. For groups != 0, the entry adds a member to the group
+ *  at slot <slot>, instance is the index of the device within the group
+ *  and member its position in the group (0..n-1, without gaps).
+ *  The descriptor above can be written as:
+ *
+ *     SLOT_MAP = BINARY 0x00,0x00,0x08,0x00,0x00,0x00, # CAN instance 0
+ *                       ...
+ *                       0x04,0x00,0x35,0x00,0x01,0x00, # IDE,     group 1
+ *                       0x04,0x00,0x44,0x00,0x01,0x01, # IDETGT,  group 1
+ *                       0x04,0x00,0x46,0x00,0x01,0x02, # IDEDISK, group 1
+ *                       ...
+ *
+ *  With LAZY_ENUM = 1, *_BrdInit does not look up the modules. The table
+ *  stays open and a slot's modules are looked up on its first access via
+ *  *_CfgInfo, *_GetMAddr or *_IrqEnable. A module that can't be found
+ *  makes its slot unusable at that time.
+ *
  *
  *  Automatic Enumeration
  *  =====================
@@ -69,6 +93,10 @@
  *  certain modules from the automatic enumeration by specifying their
  *  chameleon module codes (see chameleon.h).
  *
+ *  AUTOENUM_EXCLUDINGV2 holds one byte per device ID. Device IDs above 0xff
+ *  are excluded with AUTOENUM_EXCLUDINGV2_16, two bytes per device ID (high
+ *  byte first). It is used in addition to the other keys.
+ *
  *  Automatic enumeration of groups:
  *  For chameleon V2 tables, the driver supports device groups. For every group
  *  an own slot is assigned. The order of the devices in the table have to be
@@ -107,6 +135,11 @@
  *
  *     Required: chameleon library
  *     Switches: _ONE_NAMESPACE_PER_DRIVER_
+ *               CHAMELEON_GIRQ_D64 - access 64-bit GIRQ registers with one
+ *                                    64-bit access (memory mapped only,
+ *                                    64-bit targets with MREAD_D64)
+ *               CHAM_CACHE_LINE    - cache line size of the target, power
+ *                                    of 2 (default 64)
  *
  *---------------------------------------------------------------------------
  * Copyright 2003-2019, MEN Mikro Elektronik GmbH
@@ -143,6 +176,7 @@
 #define MAC_MEM_MAPPED
 #endif
 #include <MEN/maccess.h>
+#include <MEN/bb_chameleon_drv.h>	/* board specific codes and data */
 
 /*-----------------------------------------+
   |  DEFINES                                 |
@@ -165,11 +199,21 @@
 
 #define CHAMELEON_BBIS_MAX_DEVS	256			/* max number of devices supported */
 #define CHAMELEON_BBIS_MAX_GRPS	15			/* max number of groups supported */
+#define CHAM_SLOT_KEYS_NUM		16			/* DEVICE_ID(V2)_n always read */
 #define CHAMELEON_NO_DEV		0xfffd		/* flags devId[x] invalid */
 #define CHAMELEON_BBIS_GROUP	0xfffe		/* flags devId[x] is a group */
+#define CHAMELEON_NO_SLOT		0xffff		/* flags grpSlot[x] unassigned */
+#define CHAMELEON_GRP_EXCL		0xfffe		/* flags grpSlot[x] excluded */
 #define MAX_EXCL_MODCODES		0xff		/* number of max excluded module codes */
+#define CHAM_DEVID_NUM			0x10000		/* size of 16-bit devId space */
 #define MAX_PCI_PATH			16		    /* max number of bridges to devices */
 #define PCI_SECONDARY_BUS_NUMBER	0x19	/* PCI bridge config */
+#define CHAM_SNAP_CHUNK			64			/* units per snapshot grow step */
+#define CHAM_SLOTMAP_ENTRY		6			/* bytes per SLOT_MAP entry */
+#define CHAM_SLOTMAP_MAX		(2*CHAMELEON_BBIS_MAX_DEVS) /* max SLOT_MAP entries */
+#ifndef CHAM_CACHE_LINE
+#define CHAM_CACHE_LINE			64			/* alignment of CHAMELEON_IRQ_PEND */
+#endif
 
 #define BBCHAM_GIRQ_SPACE_SIZE		0x20		/* 32 byte register + reserved */
 #define BBCHAM_GIRQ_IRQ_REQ			0x00		/* interrupt request register */
@@ -178,6 +222,57 @@
 #define BBCHAM_GIRQ_API_VER_OFF		24			/* topmost byte */
 #define BBCHAM_GIRQ_IN_USE			0x14		/* in use register */
 #define BBCHAM_GIRQ_IN_USE_BIT		0x1			/* in use bit */
+#define BBCHAM_GIRQ_INUSE_TOUT		10000		/* default INUSE timeout [us] */
+#define BBCHAM_GIRQ_INUSE_DLY_MIN	10			/* first INUSE poll delay [us] */
+#define BBCHAM_GIRQ_INUSE_DLY_MAX	640			/* max INUSE poll delay [us] */
+
+/* GirqUpdate() modes */
+#define GIRQ_UPD_ENABLE			0			/* enable/disable requested by driver */
+#define GIRQ_UPD_RELEASE		1			/* moderation: re-enable held bits */
+#define GIRQ_UPD_FLUSH			2			/* write deferred enables only */
+
+/*
+ * lock of G_girqList: a static flag set by test-and-set, so there is no
+ * OSS object that must be created first. Task context only, a waiting
+ * caller sleeps. Without compiler support, the MDIS kernel serializes
+ * *_BrdInit and *_BrdExit.
+ */
+#if defined(__GNUC__)
+#define CHAM_TAS(p)			__sync_lock_test_and_set( (p), 1 )
+#define CHAM_TAS_CLR(p)		__sync_lock_release( (p) )
+#elif defined(_MSC_VER)
+#define CHAM_TAS(p)			InterlockedExchange( (p), 1 )
+#define CHAM_TAS_CLR(p)		InterlockedExchange( (p), 0 )
+#else
+#define CHAM_TAS(p)			(*(p) ? 1 : (*(p) = 1, 0))
+#define CHAM_TAS_CLR(p)		(*(p) = 0)
+#endif
+#define GIRQ_LIST_LOCK(h)	{ while( CHAM_TAS( &G_girqListLock ) )	\
+      OSS_Delay( (h)->osHdl, 1 ); }
+#define GIRQ_LIST_UNLOCK()	CHAM_TAS_CLR( &G_girqListLock )
+
+/* interrupt moderation defaults */
+#define IRQ_MOD_COUNT_DEF		1000		/* interrupts per window */
+#define IRQ_MOD_WINDOW_DEF		10			/* window [ms] */
+#define IRQ_MOD_HOLDOFF_DEF		1			/* holdoff [ms] */
+
+/*
+ * IrqModerate() arms the holdoff alarm in interrupt context. OSS_AlarmSet()
+ * allows that on Linux (mod_timer) and VxWorks (wdStart) only, other OSs
+ * reject IRQ_MOD_SLOTS.
+ */
+#if defined(LINUX) || defined(VXWORKS)
+#define CHAM_IRQ_MOD_SUPP
+#endif
+
+/*
+ * *_IrqSrvInit() answers a slot after the pending slots of higher IRQ_PRIO
+ * and relies on the level triggered line to fire again for it. A message
+ * signaled interrupt is not repeated, so the A21 MSI variant doesn't defer.
+ */
+#ifndef CHAMELEON_USE_A21_MSI
+#define CHAM_IRQ_PRIO_DEFER
+#endif
 
 /* switch between io and mem maccess macros */
 #define _MREAD_D32(ret,ma,offs) {			\
@@ -196,18 +291,92 @@
     }							\
   }
 
+#ifdef CHAMELEON_GIRQ_D64
+/* 64-bit access, memory mapped GIRQ only, see GirqRegRead() */
+#if !defined(_LP64) && !defined(__LP64__) && !defined(_WIN64)
+#error "CHAMELEON_GIRQ_D64 needs a 64-bit target"
+#endif
+#if !defined(MREAD_D64) || !defined(MWRITE_D64)
+#error "CHAMELEON_GIRQ_D64 needs MREAD_D64/MWRITE_D64 from maccess.h"
+#endif
+#define GIRQ_ACC_HALVES(g)	((g)->type == OSS_ADDRSPACE_MEM ? 2 : 1)
+#else
+#define GIRQ_ACC_HALVES(g)	1	/* 32-bit halves per GIRQ access */
+#endif
+
 /*-----------------------------------------+
   |  TYPEDEFS                                |
   +-----------------------------------------*/
+/* member tables follow the struct in the same memory block, see GrpAlloc() */
 typedef struct {
   u_int32 grpId;									/* group ID from Table */
-  u_int16	devId[CHAMELEON_BBIS_MAX_DEVS];         /* from DEVICE_IDV2_n */
-  u_int16 idx[CHAMELEON_BBIS_MAX_DEVS];			/* index (when more than one dev with same ID in group) */
-  void*   dev[CHAMELEON_BBIS_MAX_DEVS]; 			/* info of each module */
-  u_int32 devGotSize[CHAMELEON_BBIS_MAX_DEVS];	/* mem allocated for each dev */
+  u_int16	*devId;         						/* from DEVICE_IDV2_n */
+  u_int16 *idx;									/* index (when more than one dev with same ID in group) */
+  void*   *dev; 									/* info of each module (in unit arena) */
   int32 	devCount;								/* num of devices in group */
+  int32 	memberNum;								/* size of member tables */
 }BBIS_CHAM_GRP;
 
+/* interrupt routing of a slot, see IrqRouteBuild() */
+typedef struct {
+  u_int32	mask;				/* GIRQ bit within half, 0=no interrupt */
+  u_int32	level;				/* interrupt level */
+  u_int32	vector;				/* interrupt vector */
+  u_int8	offs;				/* offset of GIRQ half: 0=lower, 4=upper */
+  u_int8	mode;				/* BBIS_IRQ_NONE | BBIS_IRQ_SHARED */
+  u_int16	flags;				/* CHAM_IRQ_xxx */
+  u_int32	modCnt;				/* moderation: interrupts in window */
+  u_int32	modStart;			/* moderation: window start [ticks] */
+} BBIS_CHAM_IRQ;
+
+#define CHAM_IRQ_POLL	0x0001		/* slot is polled (IRQ_POLL_SLOTS) */
+#define CHAM_IRQ_MOD	0x0002		/* slot is moderated (IRQ_MOD_SLOTS) */
+#define CHAM_IRQ_PRIO_NUM	8		/* IRQ_PRIO levels, 0=highest */
+#define CHAM_GIRQ_BITS	64			/* interrupt bits of GIRQ */
+
+/* GIRQ unit state shared by all handles of one FPGA, see GirqAttach() */
+typedef struct BBIS_CHAM_GIRQ {
+  struct BBIS_CHAM_GIRQ *next;	/* next in G_girqList */
+  u_int32	refCnt;				/* number of attached handles */
+  u_int32	gotSize;			/* mem allocated for this struct */
+  u_int32	type;				/* 0=OSS_ADDRSPACE_MEM, 1=OSS_ADDRSPACE_IO */
+  char		*physAddr;			/* GIRQ unit physical address */
+  char		*virtAddr;			/* GIRQ unit virtual address */
+  u_int32	apiVersion;			/* GIRQ application feature register */
+  u_int32	en[2];				/* shadow of IRQ_EN (lower/upper) */
+  u_int32	want[2];			/* IRQ_EN bits enabled by drivers */
+  u_int32	held[2];			/* IRQ_EN bits held off by moderation */
+  u_int32	pend[2];			/* deferred enables not yet in IRQ_EN */
+  CHAMELEON_GIRQ_STATS	stats;	/* INUSE lock statistics */
+  OSS_SPINL_HANDLE	*slHdl;		/* spin lock handle */
+#ifdef VXWORKS
+  OSS_SPINL_HANDLE	vxSpinlock;	/* vxWorks only: spinlock struct (not pointer to it!) */
+#endif
+} BBIS_CHAM_GIRQ;
+
+/* in-RAM copy of the chameleon table units, see SnapRead() */
+typedef struct {
+  CHAMELEONV2_UNIT *unit;		/* units in table order */
+  u_int32	unitGotSize;		/* mem allocated for unit[] */
+  u_int16	*index;				/* unit[] numbers sorted by devId/group */
+  u_int32	indexGotSize;		/* mem allocated for index[] */
+  u_int32	num;				/* number of units */
+} BBIS_CHAM_SNAP;
+
+/* bit operations on u_int32 bitmaps */
+#define BITMAP_SET(map,n)	((map)[(n) >> 5] |= ((u_int32)1 << ((n) & 31)))
+#define BITMAP_TST(map,n)	((map)[(n) >> 5] &  ((u_int32)1 << ((n) & 31)))
+
+/* slot not within slot tables or not used */
+#define SLOT_FREE(h,s)	((s) >= (h)->slotNum || (h)->devId[s] == CHAMELEON_NO_DEV)
+
+/* IRQ_PRIO of slot, lowest priority when not in descriptor */
+#define SLOT_PRIO(h,s)	((s) < (h)->irqPrioNum ? (h)->irqPrio[s] : \
+			 CHAM_IRQ_PRIO_NUM - 1)
+
+/* sort key of snapshot index */
+#define SNAP_KEY(u)	(((u_int32)(u)->devId << 16) | (u)->group)
+
 typedef struct {
   MDIS_IDENT_FUNCT_TBL idFuncTbl;	/* id function table		*/
   CHAM_FUNCTBL	chamFuncTbl[2];	/* chameleon V2 function table */
@@ -225,31 +394,71 @@ typedef struct {
   u_int32		pciFuncNbr;			/* PCI function number of FPGA	*/
   u_int8		pciPath[MAX_PCI_PATH]; /* PCI path from desc		*/
   u_int32		pciPathLen;			/* number of bytes in pciPath	*/
+#ifdef CHAMELEON_USE_PCITABLE
+  u_int32		pciIrqLevel;		/* OSS_PCI_INTERRUPT_LINE of FPGA */
+  u_int32		pciIrqVector;		/* vector of pciIrqLevel */
+#endif
   /* ISAbus */
 #else
   u_int32		isaAddr;		/* ISA base address */
   u_int32		isaIrqNbr;		/* ISA device IRQ number */
 #endif /* CHAM_ISA */
-  u_int16		devId[CHAMELEON_BBIS_MAX_DEVS]; /* copy of DEVICE_IDV2_n */
-  int16   	inst[CHAMELEON_BBIS_MAX_DEVS];	/* instance (V2) else -1 */
-  u_int32 	idx[CHAMELEON_BBIS_MAX_DEVS];	/* index of cham device */
-  void*		dev[CHAMELEON_BBIS_MAX_DEVS];	/* info of module */
-  u_int32 	devGotSize[CHAMELEON_BBIS_MAX_DEVS];/* mem allocated for each dev */
+  /* slot tables [slotNum], see SlotTblResize() */
+  u_int32		slotNum;			/* number of entries in slot tables */
+  u_int16		*devId;				/* copy of DEVICE_IDV2_n */
+  u_int16		*devIdInit;			/* devId[] from *_Init (restored by *_BrdInit) */
+  int16   	*inst;				/* instance (V2) else -1 */
+  u_int32 	*idx;				/* index of cham device */
+  void*		*dev;				/* info of module (in unit arena) or group */
+  BBIS_CHAM_IRQ	*irq;			/* interrupt routing */
+  u_int32 	*devGotSize;		/* mem allocated for group, 0 for unit */
+  u_int16		*used;				/* [usedNum] occupied slots, ascending */
+  u_int32		usedNum;			/* number of occupied slots */
+  u_int16		*irqBitNext;		/* next slot of same GIRQ bit, see IrqBitAdd() */
+  u_int32		(*irqPrioMask)[2];	/* [CHAM_IRQ_PRIO_NUM] GIRQ bits per priority */
+  u_int16		*irqBitSlot;		/* [CHAM_GIRQ_BITS] first slot of GIRQ bit */
+  void		*slotTbl;			/* memory of slot tables */
+  u_int32		slotTblGotSize;		/* mem allocated for slotTbl */
+  CHAMELEONV2_UNIT	*unitArena;		/* unit info of all slots and group members */
+  u_int32		unitArenaGotSize;	/* mem allocated for unitArena */
+  u_int32		unitArenaUsed;		/* lazy enumeration: units looked up */
+  u_int32		lazyEnum;			/* <>0: look up modules on first access */
+  CHAMELEONV2_HANDLE	*chamHdl;	/* lazy enumeration: open table */
+  OSS_SPINL_HANDLE	*slHdl;		/* lazy enumeration: lock of looked up slots */
+#ifdef VXWORKS
+  OSS_SPINL_HANDLE	vxSpinlock;	/* vxWorks only: spinlock struct (not pointer to it!) */
+#endif
+  OSS_SEM_HANDLE	*lazySem;	/* lazy enumeration: serializes lookups */
   int32		devCount;						/* num of slots occupied */
   u_int32		tblType;			/* 0=OSS_ADDRSPACE_MEM, 1=OSS_ADDRSPACE_IO */
-  u_int32		girqType;			/* 0=OSS_ADDRSPACE_MEM, 1=OSS_ADDRSPACE_IO */
-  char 		*girqPhysAddr;		/* GIRQ unit physical address */
-  char 		*girqVirtAddr;		/* GIRQ unit virtual address */
-  u_int32		girqApiVersion;		/* GIRQ application feature register */
+  BBIS_CHAM_GIRQ	*girq;			/* shared GIRQ unit state or NULL */
+  u_int32		girqInUseTout;		/* INUSE lock timeout [us] */
+  u_int32		irqPoll[CHAMELEON_BBIS_MAX_DEVS/32]; /* bitmap of polled slots */
+  u_int32		irqMod[CHAMELEON_BBIS_MAX_DEVS/32];  /* bitmap of moderated slots */
+  u_int32		irqModCount;		/* moderation: max interrupts per window */
+  u_int8		*irqPrio;			/* [irqPrioNum] IRQ_PRIO or NULL, see SLOT_PRIO */
+  u_int32		irqPrioNum;			/* number of slots in IRQ_PRIO */
+  u_int32		irqPrioGotSize;		/* mem allocated for irqPrio */
+  CHAMELEON_IRQ_PEND	*irqPend;	/* published IRQ_REQ or NULL */
+  void		*irqPendMem;		/* mem of irqPend (unaligned) */
+  u_int32		irqPendGotSize;		/* mem allocated for irqPendMem */
+  u_int32		irqModWinTicks;		/* moderation: window [ticks] */
+  u_int32		irqModHoldoff;		/* moderation: holdoff [ms] */
+  OSS_ALARM_HANDLE	*irqModAlm;		/* moderation: re-enable alarm */
+  u_int32		irqModArmed;		/* irqModAlm is set */
+  u_int32		irqEnDefer;			/* deferred enables: max delay [ms], 0=off */
+  OSS_ALARM_HANDLE	*irqEnAlm;		/* deferred enables: flush alarm */
+  u_int32		irqEnArmed;			/* irqEnAlm is set */
+  u_int32		girqHeld[2];		/* IRQ_EN bits held off by own moderation */
   u_int32		autoEnum;			/* <>0: auomatic enumeration */
-  u_int8      exclModCodes[MAX_EXCL_MODCODES]; /* excluded module codes */
-  u_int32		exclModCodesNbr;		/* number of excluded module codes */
+  u_int32		*exclDevIds;		/* bitmap of excluded devIds or NULL */
+  u_int32		exclDevIdsGotSize;	/* mem allocated for exclDevIds */
   int32       			devCountInit;       /* devCount value from *_Init for multiple calls of *_BrdInit */
-  OSS_SPINL_HANDLE 		*slHdl;				/* spin lock handle */
-#ifdef VXWORKS
-  OSS_SPINL_HANDLE 		vxSpinlock;			/* vxWorks only: spinlock struct (not pointer to it!) */
-#endif
   CHAMELEONV2_INFO	chamInfo;		/* global chameleon device info */
+  u_int32		chamLibInit;		/* chamFuncTbl[] initialized */
+  u_int32		brdInitDone;		/* *_BrdInit succeeded, fp* valid */
+  CHAMELEONV2_TABLE	fpTbl;			/* fingerprint: table ident ... */
+  u_int32		fpUnitNum;			/* ... and number of units */
 } BBIS_HANDLE;
 
 /* include files which need BBIS_HANDLE */
@@ -264,6 +473,17 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 #ifdef OSS_VXBUS_SUPPORT
 IMPORT VXB_DEVICE_ID 	sysGetMdisBusCtrlID(void);
 #endif
+
+/* GIRQ units in use, see GirqAttach() */
+static BBIS_CHAM_GIRQ *G_girqList = NULL;
+static volatile long G_girqListLock = 0;	/* locks G_girqList and refCnt */
+
+/* count trailing zeros of x<>0 by de Bruijn sequence, see IrqOrder() */
+static const u_int8 G_ctzTbl[32] = {
+  0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+  31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+#define CTZ32(x)	G_ctzTbl[(((x) & (0 - (x))) * 0x077CB531UL & 0xffffffffUL) >> 27]
 /*-----------------------------------------+
   |  PROTOTYPES                              |
   +-----------------------------------------*/
@@ -295,6 +515,53 @@ static int32 CHAMELEON_Unused(void);
 static char* Ident( void );
 static int32 Cleanup(BBIS_HANDLE *h, int32 retCode);
 static int32 CfgInfoSlot( BBIS_HANDLE *h, va_list argptr );
+static int32 ExclDevIdsAdd( BBIS_HANDLE *h, u_int8 *excl, u_int32 nbr,
+			    u_int32 width, int isModCode );
+static int32 ParseSlotKeys( BBIS_HANDLE *h );
+static int32 ParseSlotMap( BBIS_HANDLE *h );
+static int32 SlotTblResize( BBIS_HANDLE *h, u_int32 num );
+static void SlotTblFree( BBIS_HANDLE *h );
+static void SlotUsedUpdate( BBIS_HANDLE *h );
+static int32 LazyPrepare( BBIS_HANDLE *h );
+static int32 SlotResolve( BBIS_HANDLE *h, u_int32 slot );
+static int32 SlotResolved( BBIS_HANDLE *h, u_int32 slot, void **unitPP,
+			   int32 *doneP );
+static int32 SlotUnused( BBIS_HANDLE *h, u_int32 slot );
+static void IrqRouteBuild( BBIS_HANDLE *h, u_int32 slot );
+static void IrqBitAdd( BBIS_HANDLE *h, u_int32 slot );
+static void IrqBitDel( BBIS_HANDLE *h, u_int32 slot );
+static int32 IrqPrioAbove( BBIS_HANDLE *h, u_int32 slot, u_int32 req[2],
+			   int num );
+static int32 GirqAttach( BBIS_HANDLE *h, char *physAddr, u_int32 type,
+			 u_int32 busId );
+static int32 GirqDetach( BBIS_HANDLE *h );
+static void GirqRegRead( BBIS_HANDLE *h, u_int32 reg, int half, int num,
+			 u_int32 val[2] );
+static void GirqRegWrite( BBIS_HANDLE *h, u_int32 reg, int half, int num,
+			  u_int32 val[2] );
+static int32 GirqUpdate( BBIS_HANDLE *h, u_int32 setMask[2],
+			 u_int32 clrMask[2], int32 mode );
+static void IrqModerate( BBIS_HANDLE *h, BBIS_CHAM_IRQ *r );
+static void IrqModAlarm( void *arg );
+static int32 GirqFlush( BBIS_HANDLE *h );
+static void IrqEnAlarm( void *arg );
+static int32 GirqInUseTake( BBIS_HANDLE *h );
+static int32 IrqEnableBlk( BBIS_HANDLE *h, int32 code, M_SG_BLOCK *blk );
+static int32 IrqPending( BBIS_HANDLE *h, M_SG_BLOCK *blk );
+static int32 IrqOrder( BBIS_HANDLE *h, M_SG_BLOCK *blk );
+static int32 IrqPendMap( BBIS_HANDLE *h, void **mAddr, u_int32 *mSize );
+static int32 TblUnchanged( BBIS_HANDLE *h, CHAMELEONV2_HANDLE *chamHdl,
+			   CHAMELEONV2_TABLE *tbl );
+static BBIS_CHAM_GRP *GrpAlloc( BBIS_HANDLE *h, u_int32 slot,
+				u_int32 grpId, u_int32 memberNum );
+static u_int32 UnitArenaWalk( BBIS_HANDLE *h, CHAMELEONV2_UNIT *arena );
+static int32 UnitArenaBuild( BBIS_HANDLE *h );
+static void UnitArenaFree( BBIS_HANDLE *h );
+static int32 SnapRead( BBIS_HANDLE *h, CHAMELEONV2_HANDLE *chamHdl,
+		       BBIS_CHAM_SNAP *snap );
+static int32 SnapFind( BBIS_CHAM_SNAP *snap, int32 idx,
+		       CHAMELEONV2_FIND *find, CHAMELEONV2_UNIT **unitP );
+static void SnapFree( BBIS_HANDLE *h, BBIS_CHAM_SNAP *snap );
 
 #ifndef CHAM_ISA
 static int32 ParsePciPath(
@@ -396,9 +663,30 @@ extern void __BB_CHAMELEON_GetEntry( BBIS_ENTRY *bbisP )
  *                  DEVICE_ADDR_IO         0                0,1
  *                  IRQ_NUMBER             TABLE_IRQ        0(=no IRQ)..max
  *                DEVICE_ID_n  (n=0..15)   -                0...31
+ *                  (n>15: read up to the first missing n)
  *                GROUP_n/DEVICE_IDV2_n  (n=0..15)          0...31
+ *                  (read up to the first missing n)
+ *                SLOT_MAP                 -                see above
+ *                LAZY_ENUM                0                0,1
  *                AUTOENUM                 0                0,1
  *                AUTOENUM_EXCLUDING       -                see chameleon.h
+ *                AUTOENUM_EXCLUDINGV2     -                binary array
+ *                AUTOENUM_EXCLUDINGV2_16  -                binary array
+ *                  (devId byte pairs, high byte first)
+ *                GIRQ_INUSE_TIMEOUT       10000            0..max [us]
+ *                IRQ_POLL_SLOTS           -                binary array
+ *                  (slots without interrupt, see *_GetStat)
+ *                IRQ_MOD_SLOTS            -                binary array
+ *                  (moderated slots, see IrqModerate(),
+ *                  Linux and VxWorks only)
+ *                IRQ_MOD_COUNT            1000             1..max
+ *                IRQ_MOD_WINDOW           10               1..max [ms]
+ *                IRQ_MOD_HOLDOFF          1                1..max [ms]
+ *                IRQ_EN_DEFER             0                0..max [ms]
+ *                  (delay of IRQ enables, see GirqUpdate())
+ *                IRQ_PRIO                 7                binary array
+ *                  (priority 0=highest..7 of slot n in byte n, see
+ *                   *_IrqSrvInit, *_GetStat CHAMELEON_BLK_IRQ_ORDER)
  *
  *---------------------------------------------------------------------------
  *  Input......:  osHdl     pointer to os specific structure
@@ -414,10 +702,9 @@ static int32 CHAMELEON_Init(
 			    BBIS_HANDLE     **hP )
 {
   BBIS_HANDLE	*h = NULL;
-  u_int32     gotsize, i, g;
+  u_int32     gotsize, i;
   int32       status;
   u_int32		value;
-  BBIS_CHAM_GRP *devGrp = NULL;
 
   /* PCIbus */
 #ifndef CHAM_ISA
@@ -439,6 +726,7 @@ static int32 CHAMELEON_Init(
   h->ownMemSize = gotsize;
   h->osHdl = osHdl;
 
+
   /*------------------------------+
     |  init id function table       |
     +------------------------------*/
@@ -482,6 +770,128 @@ static int32 CHAMELEON_Init(
   if ( status && (status!=ERR_DESC_KEY_NOTFOUND) )
     return( Cleanup(h,status) );
 
+  /* get GIRQ_INUSE_TIMEOUT (optional) */
+  status = DESC_GetUInt32( h->descHdl, BBCHAM_GIRQ_INUSE_TOUT,
+			   &h->girqInUseTout, "GIRQ_INUSE_TIMEOUT");
+  if ( status && (status!=ERR_DESC_KEY_NOTFOUND) )
+    return( Cleanup(h,status) );
+
+  /* get IRQ_POLL_SLOTS (optional) */
+  {
+    u_int8 empty = 0;
+    u_int8 pollSlots[CHAMELEON_BBIS_MAX_DEVS];
+    u_int32 pollSlotsNbr = CHAMELEON_BBIS_MAX_DEVS;
+
+    status = DESC_GetBinary( h->descHdl, &empty, 0, pollSlots,
+			     &pollSlotsNbr, "IRQ_POLL_SLOTS");
+    if( status == ERR_DESC_KEY_NOTFOUND )
+      pollSlotsNbr = 0;
+    else if( status )
+      return( Cleanup(h,status) );
+
+    for( i=0; i < pollSlotsNbr; i++ ) {
+      BITMAP_SET( h->irqPoll, pollSlots[i] );
+      DBGWRT_2(( DBH, " slot %d polled\n", pollSlots[i] ));
+    }
+  }
+
+  /* get IRQ_MOD_SLOTS and moderation parameters (optional) */
+  {
+    u_int8 empty = 0;
+    u_int8 modSlots[CHAMELEON_BBIS_MAX_DEVS];
+    u_int32 modSlotsNbr = CHAMELEON_BBIS_MAX_DEVS;
+
+    status = DESC_GetBinary( h->descHdl, &empty, 0, modSlots,
+			     &modSlotsNbr, "IRQ_MOD_SLOTS");
+    if( status == ERR_DESC_KEY_NOTFOUND )
+      modSlotsNbr = 0;
+    else if( status )
+      return( Cleanup(h,status) );
+
+    if( modSlotsNbr ) {
+#ifndef CHAM_IRQ_MOD_SUPP
+      DBGWRT_ERR((DBH, "*** BB - %s_Init: IRQ_MOD_SLOTS not supported "
+		  "on this OS\n", BBNAME ));
+      return( Cleanup(h,ERR_BBIS_DESC_PARAM) );
+#endif
+      status = DESC_GetUInt32( h->descHdl, IRQ_MOD_COUNT_DEF,
+			       &h->irqModCount, "IRQ_MOD_COUNT");
+      if( status == ERR_SUCCESS || status == ERR_DESC_KEY_NOTFOUND )
+	status = DESC_GetUInt32( h->descHdl, IRQ_MOD_WINDOW_DEF,
+				 &value, "IRQ_MOD_WINDOW");
+      if( status == ERR_SUCCESS || status == ERR_DESC_KEY_NOTFOUND )
+	status = DESC_GetUInt32( h->descHdl, IRQ_MOD_HOLDOFF_DEF,
+				 &h->irqModHoldoff, "IRQ_MOD_HOLDOFF");
+      if( status && (status!=ERR_DESC_KEY_NOTFOUND) )
+	return( Cleanup(h,status) );
+
+      /* 0 would hold off on every interrupt or never release */
+      if( h->irqModCount == 0 || value == 0 || h->irqModHoldoff == 0 ) {
+	DBGWRT_ERR((DBH, "*** BB - %s_Init: IRQ_MOD_COUNT/WINDOW/HOLDOFF "
+		    "must not be 0\n", BBNAME ));
+	return( Cleanup(h,ERR_BBIS_DESC_PARAM) );
+      }
+
+      /* window in ticks, at least one tick */
+      h->irqModWinTicks = value * OSS_TickRateGet( h->osHdl ) / 1000;
+      if( h->irqModWinTicks == 0 )
+	h->irqModWinTicks = 1;
+
+      if( (status = OSS_AlarmCreate( h->osHdl, IrqModAlarm, h,
+				     &h->irqModAlm )) )
+	return( Cleanup(h,status) );
+
+      for( i=0; i < modSlotsNbr; i++ ) {
+	BITMAP_SET( h->irqMod, modSlots[i] );
+	DBGWRT_2(( DBH, " slot %d moderated\n", modSlots[i] ));
+      }
+    }
+  }
+
+  /* get IRQ_PRIO (optional) */
+  {
+    u_int8 empty = 0;
+    u_int8 prio[CHAMELEON_BBIS_MAX_DEVS];
+    u_int32 prioNbr = CHAMELEON_BBIS_MAX_DEVS;
+
+    status = DESC_GetBinary( h->descHdl, &empty, 0, prio,
+			     &prioNbr, "IRQ_PRIO");
+    if( status == ERR_DESC_KEY_NOTFOUND )
+      prioNbr = 0;
+    else if( status )
+      return( Cleanup(h,status) );
+
+    for( i=0; (u_int32)i < prioNbr; i++ ) {
+      if( prio[i] >= CHAM_IRQ_PRIO_NUM ) {
+	DBGWRT_ERR((DBH, "*** %s_Init: IRQ_PRIO %d of slot %d too large\n",
+		    BBNAME, prio[i], i ));
+	return( Cleanup(h,ERR_BBIS_DESC_PARAM) );
+      }
+    }
+
+    /* keep the slots specified, the others get the lowest priority */
+    if( prioNbr ) {
+      h->irqPrio = (u_int8*)OSS_MemGet( h->osHdl, prioNbr,
+					&h->irqPrioGotSize );
+      if( !h->irqPrio ) {
+	DBGWRT_ERR((DBH, "*** %s_Init: no ressources f. IRQ_PRIO\n",
+		    BBNAME ));
+	return( Cleanup(h,ERR_OSS_MEM_ALLOC) );
+      }
+      OSS_MemCopy( h->osHdl, prioNbr, (char*)prio, (char*)h->irqPrio );
+      h->irqPrioNum = prioNbr;
+    }
+  }
+
+  /* get IRQ_EN_DEFER (optional) */
+  status = DESC_GetUInt32( h->descHdl, 0, &h->irqEnDefer, "IRQ_EN_DEFER");
+  if( status && (status!=ERR_DESC_KEY_NOTFOUND) )
+    return( Cleanup(h,status) );
+
+  if( h->irqEnDefer &&
+      (status = OSS_AlarmCreate( h->osHdl, IrqEnAlarm, h, &h->irqEnAlm )) )
+    return( Cleanup(h,status) );
+
   /* PCIbus */
 #ifndef CHAM_ISA
   /*---- get PCI domain/bus/device number ----*/
@@ -625,133 +1035,106 @@ static int32 CHAMELEON_Init(
   h->devCount     = 0;
   h->devCountInit = 0;
 
-  /* no device found yet */
-  for( i=0; i<CHAMELEON_BBIS_MAX_DEVS; i++ ) {
-    h->devId[i]      = CHAMELEON_NO_DEV;
-  }
-
   /* automatic enumeration */
   if( h->autoEnum ){
 
     u_int8 empty = 0;
+    u_int8 exclModCodes[2 * MAX_EXCL_MODCODES]; /* excluded devIds/modcodes */
+    u_int32 exclModCodesNbr;
+    int isModCode = 0;
+
+    /* get AUTOENUM_EXCLUDINGV2_16 (optional), 16-bit devIds */
+    exclModCodesNbr = sizeof(exclModCodes);
+    status = DESC_GetBinary( h->descHdl, &empty, 0, exclModCodes,
+			     &exclModCodesNbr, "AUTOENUM_EXCLUDINGV2_16");
+    if( status == ERR_DESC_KEY_NOTFOUND )
+      exclModCodesNbr = 0;
+    else if( status )
+      return( Cleanup(h,status) );
 
-    /* get AUTOENUM_EXCLUDING (optional) */
-    h->exclModCodesNbr = MAX_EXCL_MODCODES;
-    status = DESC_GetBinary( h->descHdl, &empty, 0, h->exclModCodes,
-			     &h->exclModCodesNbr, "AUTOENUM_EXCLUDINGV2");
-    if( status == ERR_DESC_KEY_NOTFOUND ) {
-      h->exclModCodesNbr = MAX_EXCL_MODCODES;
-      status = DESC_GetBinary( h->descHdl, &empty, 0, h->exclModCodes,
-			       &h->exclModCodesNbr, "AUTOENUM_EXCLUDING");
-      if( !status ) {
-	for( i=0; i < h->exclModCodesNbr; i++ ) {
-	  h->exclModCodes[i]	= (u_int8)CHAM_ModCodeToDevId(h->exclModCodes[i]);
-	}
-      } else if( status == ERR_DESC_KEY_NOTFOUND ) {
-	h->exclModCodesNbr = 0;
-      }
+    if( exclModCodesNbr & 1 ) {
+      DBGWRT_ERR((DBH, "*** BB - %s_Init: AUTOENUM_EXCLUDINGV2_16 needs "
+		  "byte pairs\n", BBNAME ));
+      return( Cleanup(h,ERR_BBIS_DESC_PARAM) );
     }
 
-    if( status && status != ERR_DESC_KEY_NOTFOUND)
+    if( (status = ExclDevIdsAdd( h, exclModCodes, exclModCodesNbr, 2, 0 )) )
       return( Cleanup(h,status) );
 
-  } else {	/* manual enumeration? */
-
-		/* get DEVICE_ID(V2)_n, group 0*/
-    for( i=0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ){
-
-      if( (status = DESC_GetUInt32( h->descHdl, 0, &value,
-				    "DEVICE_IDV2_%d", i)) == ERR_SUCCESS )
-	{
-	  h->devId[i] = (u_int16)((value & 0xffffff00) >> 8);
-	  h->inst[i]  = (int16)(value & 0xff);
-	  h->idx[i]   = 0;
-	} else if( (status = DESC_GetUInt32( h->descHdl, 0, &value,
-					     "DEVICE_ID_%d", i)) == ERR_SUCCESS )
-	{
-	  u_int16 modId	= (u_int16)((value & 0xffffff00) >> 8);
-	  h->inst[i]  = -1;
-	  h->idx[i]   = value & 0xff;
-	  h->devId[i] = CHAM_ModCodeToDevId( modId  );
-	}
-      if( status == ERR_SUCCESS)
-	{
-	  h->devCount++;
-	  DBGWRT_2(( DBH, " DEVICE_ID(V2)_%d = 0x%x\n", i, h->devId[i] ));
-	}
+    /* get AUTOENUM_EXCLUDINGV2 or AUTOENUM_EXCLUDING (optional) */
+    exclModCodesNbr = MAX_EXCL_MODCODES;
+    status = DESC_GetBinary( h->descHdl, &empty, 0, exclModCodes,
+			     &exclModCodesNbr, "AUTOENUM_EXCLUDINGV2");
+    if( status == ERR_DESC_KEY_NOTFOUND ) {
+      exclModCodesNbr = MAX_EXCL_MODCODES;
+      status = DESC_GetBinary( h->descHdl, &empty, 0, exclModCodes,
+			       &exclModCodesNbr, "AUTOENUM_EXCLUDING");
+      isModCode = 1;
+      if( status == ERR_DESC_KEY_NOTFOUND )
+	exclModCodesNbr = 0;
     }
-    /* get GROUP_n/DEVICE_IDV2_n */
-    for( g=0; g < CHAMELEON_BBIS_MAX_GRPS &&
-	   h->devCount < CHAMELEON_BBIS_MAX_DEVS; g++ )
-      {
-	status = DESC_GetUInt32( h->descHdl, 0, &value,
-				 "GROUP_%d/GROUP_ID", g);
 
-	if( status == ERR_SUCCESS )
-	  {
-	    /* group exists in descriptor? get memory for group */
-	    h->dev[g] = (BBIS_CHAM_GRP *)OSS_MemGet( h->osHdl,
-						     sizeof( BBIS_CHAM_GRP ),
-						     &h->devGotSize[g]);
-	    if( !h->dev[g] ) {
-	      DBGWRT_ERR((DBH, "*** %s_Init: no ressources\n",
-			  BBNAME));
-	      return(  Cleanup(h,ERR_BBIS_DESC_PARAM) );
-	    }
-	    OSS_MemFill( h->osHdl, sizeof( BBIS_CHAM_GRP ), (char*)h->dev[g], 0x00 );
-	    devGrp = (BBIS_CHAM_GRP*)h->dev[g];
+    if( status && status != ERR_DESC_KEY_NOTFOUND)
+      return( Cleanup(h,status) );
 
-	    devGrp->devCount = 0;
-	    devGrp->grpId    = value;
-	    /* anounce group */
-	    h->devId[g]  = CHAMELEON_BBIS_GROUP ;
-	    h->devCount++;
-	  } else {
-	  continue;
-	}
+    if( (status = ExclDevIdsAdd( h, exclModCodes, exclModCodesNbr, 1,
+				 isModCode )) )
+      return( Cleanup(h,status) );
 
-	for( i=0; i < CHAMELEON_BBIS_MAX_DEVS; i++ )
-	  {
+  } else {	/* manual enumeration? */
 
-	    status = DESC_GetUInt32( h->descHdl, 0, &value,
-				     "GROUP_%d/DEVICE_IDV2_%d", g, i);
+    /* parse into slot tables of max. size, shrink them below */
+    if( (status = SlotTblResize( h, CHAMELEON_BBIS_MAX_DEVS )) )
+      return( Cleanup(h,status) );
+
+    /* SLOT_MAP takes precedence over the single keys */
+    status = ParseSlotMap( h );
+    if( status == ERR_DESC_KEY_NOTFOUND )
+      status = ParseSlotKeys( h );
+    SlotUsedUpdate( h );
+    if( status )
+      return( Cleanup(h,status) );
 
-	    if( status == ERR_SUCCESS)
-	      {
-		devGrp->devId[i] = (u_int16)((value & 0xffffff00) >> 8);
-		devGrp->idx[i]   = (int16)value & 0xff;
-		devGrp->devCount++;
-		DBGWRT_2(( DBH, " GROUP_%d/DEVICE_IDV2_%d = 0x%x\n",
-			   g, i, value ));
-	      } else {
-	      devGrp->devId[i]      = CHAMELEON_NO_DEV;
-	    }
-	  }
-      }
     /*--- check if any device specified ---*/
     if( h->devCount == 0 ){
       DBGWRT_ERR((DBH, "*** %s_Init: No devices in descriptor!\n",
 		  BBNAME));
       return( Cleanup(h,ERR_BBIS_DESC_PARAM) );
     }
-  }
 
-  /*------------------------------+
-    |  create spinlock              |
-    +-----------------------------*/
+    /* size slot tables up to highest slot used */
+    if( (status = SlotTblResize( h, h->used[h->usedNum - 1] + 1 )) )
+      return( Cleanup(h,status) );
+
+    /* get LAZY_ENUM (optional) */
+    status = DESC_GetUInt32( h->descHdl, 0, &h->lazyEnum, "LAZY_ENUM");
+    if( status && (status!=ERR_DESC_KEY_NOTFOUND) )
+      return( Cleanup(h,status) );
 
+    /* lazy enumeration: concurrent lookups of slots are serialized */
+    if( h->lazyEnum ) {
 #ifdef VXWORKS
-  h->slHdl = &h->vxSpinlock;
+      h->slHdl = &h->vxSpinlock;
 #endif
+      status = OSS_SpinLockCreate( h->osHdl, &h->slHdl );
+      if( status ) {
+	DBGWRT_ERR((DBH, "*** BB - %s_Init: OSS_SpinLockCreate() failed! "
+		    "Error 0x%0x\n", BBNAME, status ));
+	return( Cleanup(h,status) );
+      }
 
-  status = OSS_SpinLockCreate( h->osHdl, &h->slHdl);
-  if (status) {
-    DBGWRT_ERR((DBH, "*** BB - %s_Init: OSS_SpinLockCreate() failed! "
-		"Error 0x%0x\n",
-		BBNAME, status ));
-    return( Cleanup(h,status));
-  }
+      status = OSS_SemCreate( h->osHdl, OSS_SEM_BIN, 1, &h->lazySem );
+      if( status ) {
+	DBGWRT_ERR((DBH, "*** BB - %s_Init: OSS_SemCreate() failed! "
+		    "Error 0x%0x\n", BBNAME, status ));
+	return( Cleanup(h,status) );
+      }
+    }
 
+    /* keep slot assignment, *_BrdInit flags slots not found as unusable */
+    OSS_MemCopy( h->osHdl, h->slotNum * sizeof(u_int16),
+		 (char*)h->devId, (char*)h->devIdInit );
+  }
 
   /* store current devCount value to ignore repeated calls of *_BrdInit
    * starting at updated count
@@ -765,8 +1148,16 @@ static int32 CHAMELEON_Init(
  *  Description:  Board initialization.
  *
  *  Look for chameleon FPGA.
- *  For each module specified in descriptor, look for that module and save
- *  information about it.
+ *  The units of the chameleon table are read only once into a RAM snapshot.
+ *  For each module specified in descriptor, look for that module in the
+ *  snapshot and save information about it. The unit info of all slots is
+ *  finally copied into one memory block (unit arena).
+ *
+ *  *_BrdInit may be called multiple times. The table is identified by
+ *  file/model/revision from TableIdent() and its number of units. When
+ *  this fingerprint is unchanged since the last successful call, the
+ *  previous enumeration is kept. Otherwise the previous state is released
+ *  and the table is enumerated again.
  *
  *---------------------------------------------------------------------------
  *  Input......:  h			pointer to board handle structure
@@ -778,32 +1169,45 @@ static int32 CHAMELEON_BrdInit(
 {
   CHAMELEONV2_HANDLE *chamHdl = NULL;	/* chameleon V2 handle */
   CHAMELEONV2_UNIT chamUnit;		/* unit info of current module */
+  CHAMELEONV2_UNIT *unitP;		/* unit in snapshot */
+  BBIS_CHAM_SNAP snap;			/* RAM copy of chameleon table */
   int32 chErr, error=0, i, u, n;
   u_int32 exclude;
   BBIS_CHAM_GRP *lGrp = NULL;
-  u_int32 gotSize = 0, un;
+  u_int32 un;
   u_int8 groupBaseDevIncluded=0;
+  u_int16 *grpSlot = NULL;		/* autoenum: slot of each group ID */
+  u_int16 *grpNum;				/* autoenum: members of each group ID */
+  u_int32 grpSlotGotSize = 0, grpMax = 0;
+
+  CHAMELEONV2_TABLE tbl;		/* table ident (fingerprint) */
 
   DBGWRT_1((DBH, "BB - %s_BrdInit\n",BBNAME));
+  OSS_MemFill( h->osHdl, sizeof(snap), (char*)&snap, 0x00 );
+
   /* PCIbus */
 #ifndef CHAM_ISA
   DBGWRT_2((DBH," pci Domain: %d \n", h->pciDomainNbr));
 #endif
 
-  /* init chameleon lib - mem */
-  if( (chErr = CHAM_InitMem( &h->chamFuncTbl[0] )) != CHAMELEON_OK ){
-    DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_InitMem error 0x%x!\n",
-		BBNAME, chErr));
-    error = ERR_BBIS_ILL_SLOT;
-    goto ABORT_NO_CHAM;
-  }
+  /* function tables of chameleon lib are only set up once */
+  if( !h->chamLibInit ) {
+    /* init chameleon lib - mem */
+    if( (chErr = CHAM_InitMem( &h->chamFuncTbl[0] )) != CHAMELEON_OK ){
+      DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_InitMem error 0x%x!\n",
+		  BBNAME, chErr));
+      error = ERR_BBIS_ILL_SLOT;
+      goto ABORT_NO_CHAM;
+    }
 
-  /* init chameleon lib - io */
-  if( (chErr = CHAM_InitIo( &h->chamFuncTbl[1] )) != CHAMELEON_OK ){
-    DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_InitIo error 0x%x!\n",
-		BBNAME, chErr));
-    error = ERR_BBIS_ILL_SLOT;
-    goto ABORT_NO_CHAM;
+    /* init chameleon lib - io */
+    if( (chErr = CHAM_InitIo( &h->chamFuncTbl[1] )) != CHAMELEON_OK ){
+      DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_InitIo error 0x%x!\n",
+		  BBNAME, chErr));
+      error = ERR_BBIS_ILL_SLOT;
+      goto ABORT_NO_CHAM;
+    }
+    h->chamLibInit = 1;
   }
 
   /* PCIbus */
@@ -833,6 +1237,22 @@ static int32 CHAMELEON_BrdInit(
     error = ERR_BBIS_ILL_SLOT;
     goto ABORT;
   }
+
+#ifdef CHAMELEON_USE_PCITABLE
+  /*
+   * Take irq level from PCI config space instead from
+   * table inside FPGA (normal use case, except e.g. EM08).
+   * Same for all slots, so read it only once.
+   */
+  if( OSS_PciGetConfig( h->osHdl,
+			OSS_MERGE_BUS_DOMAIN(h->pciBusNbr, h->pciDomainNbr),
+			h->pciDevNbr, 0, OSS_PCI_INTERRUPT_LINE,
+			(int32*)&h->pciIrqLevel ) )
+    h->pciIrqLevel = 0xff;	/* no interrupt available */
+
+  OSS_IrqLevelToVector( h->osHdl, BUSTYPE,
+			h->pciIrqLevel, (int32 *)&h->pciIrqVector );
+#endif
   /* ISAbus */
 #else
   /* using mem/io function table according specified address type
@@ -849,19 +1269,20 @@ static int32 CHAMELEON_BrdInit(
     }
 #endif /* CHAM_ISA */
 
+  /* table ident is fingerprint for repeated calls */
+  if( (error = h->chamFuncTbl[h->tblType].TableIdent( chamHdl, 0, &tbl )) ){
+    DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_TableIdent error 0x%x!\n",
+		BBNAME, error));
+    error = ERR_BBIS;
+    goto ABORT;
+  }
+
 #ifdef DBG
   {
     /*
      * DBG: Always print chameleon-V2 table info about
      * the table of the bus where the caller resides
      */
-    CHAMELEONV2_TABLE tbl;
-    if( (error = h->chamFuncTbl[h->tblType].TableIdent( chamHdl, 0, &tbl )) ){
-      DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_TableIdent error 0x%x!\n",
-		  BBNAME, error));
-      error = ERR_BBIS;
-      goto ABORT;
-    }
     /* PCIbus */
 #ifndef CHAM_ISA
     DBGWRT_ERR((DBH, "--- %s_BrdInit: PciDev=%d/%d/%d/%d: file=%s, model=%c, rev=0x%02x\n",
@@ -877,78 +1298,95 @@ static int32 CHAMELEON_BrdInit(
   }
 #endif /* DBG */
 
+  /* same table as on last call? keep enumeration */
+  if( h->brdInitDone && TblUnchanged( h, chamHdl, &tbl ) ) {
+    DBGWRT_2((DBH," table unchanged, keep enumeration\n"));
+    goto ABORT;
+  }
+
+  /* release state of last call (unit info, GIRQ mapping) */
+  if( (error = CHAMELEON_BrdExit( h )) )
+    goto ABORT;
+
   /* restore current devCount value to init value counter.
    * *_BrdInit may be called multiple times and shall be started at equal counter
    */
   h->devCount = h->devCountInit;
 
+  /* restore slot assignment from *_Init (manual enumeration) */
+  for( un=0; un < h->usedNum; un++ )
+    h->devId[h->used[un]] = h->devIdInit[h->used[un]];
+
+  /* lazy enumeration: modules are looked up on first access of slot */
+  if( h->lazyEnum ) {
+    if( (error = LazyPrepare( h )) )
+      goto ABORT;
+  }
+  /* read chameleon table once, all lookups below use the snapshot */
+  else if( (error = SnapRead( h, chamHdl, &snap )) )
+    goto ABORT;
+
   /* automatic enumeration? */
   if( h->autoEnum ){
-    u_int8 excludedGroups[CHAMELEON_BBIS_MAX_GRPS];
     DBGWRT_2((DBH," perform automatic enumeration\n"));
 
-    excludedGroups[0] = 0;
+    /* group ID -> slot map (or CHAMELEON_GRP_EXCL), filled while
+       enumerating, and number of members of each group ID */
+    for( un=0; un < snap.num; un++ )
+      if( snap.unit[un].group > grpMax )
+	grpMax = snap.unit[un].group;
+
+    grpSlot = (u_int16*)OSS_MemGet( h->osHdl,
+				    2 * (grpMax + 1) * sizeof(u_int16),
+				    &grpSlotGotSize );
+    if( !grpSlot ) {
+      DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources\n", BBNAME));
+      error = ERR_OSS_MEM_ALLOC;
+      goto ABORT;
+    }
+    grpNum = &grpSlot[grpMax + 1];
+    for( un=0; un <= grpMax; un++ ) {
+      grpSlot[un] = CHAMELEON_NO_SLOT;
+      grpNum[un]  = 0;
+    }
+    for( un=0; un < snap.num; un++ )
+      grpNum[snap.unit[un].group]++;
+
+    /* slot tables for all units, shrinked after enumeration */
+    SlotTblFree( h );
+    if( (error = SlotTblResize( h, snap.num < CHAMELEON_BBIS_MAX_DEVS ?
+				snap.num : CHAMELEON_BBIS_MAX_DEVS )) )
+      goto ABORT;
 
     for( u=0; h->devCount < CHAMELEON_BBIS_MAX_DEVS; u++ ){
 
-      /* get unit info */
-      chErr = h->chamFuncTbl[h->tblType].UnitIdent( chamHdl, u, &chamUnit );
-
       /* no unit? => leave loop */
-      if( chErr == CHAMELEONV2_NO_MORE_ENTRIES )
+      if( (u_int32)u >= snap.num )
 	break;
 
-      /* group? */
-      if( chamUnit.group != 0 ){
-	groupBaseDevIncluded = 0;
-	/* group already existant? */
-	for( n=0; n < h->devCount; n++) {
-	  if( h->devId[n] == CHAMELEON_BBIS_GROUP &&
-	      ((BBIS_CHAM_GRP *)h->dev[n])->grpId == chamUnit.group){
-	    groupBaseDevIncluded = 1;
-	    break;
-	  }
-	}
-      }
+      /* get unit info */
+      chamUnit = snap.unit[u];
 
       exclude = 0;
 
-      /* no group OR base device of group not yet included */
-      if( (chamUnit.group == 0) || (groupBaseDevIncluded == 0) ){
+      /* excluding members of groups marked for excluding */
+      if( chamUnit.group != 0 && grpSlot[chamUnit.group] == CHAMELEON_GRP_EXCL )
+	exclude = 1;
 
-	/* excluding specified module codes */
-	for( un=0; un < h->exclModCodesNbr; un++ )
-	{
-		if( chamUnit.devId == h->exclModCodes[un] ){
-			DBGWRT_2((DBH," unit %d: devId=0x%x excluded\n", u, h->exclModCodes[un] ));
-
-			exclude = 1;
-			if( chamUnit.group != 0 ) {
-				/* group, exclude also rest of group members */
-				for( i=0; i < CHAMELEON_BBIS_MAX_GRPS - 1; i++) {
-					if( excludedGroups[i] == 0 ) {
-						/* end of list, first module of group */
-						excludedGroups[i] = (u_int8)chamUnit.group;
-						excludedGroups[i+1] = 0; /* mark end of list */
-						break;
-					}
-				}
-			}
-	    break;
-		}
-	}
+      /* group? already existant? */
+      if( chamUnit.group != 0 )
+	groupBaseDevIncluded = ( grpSlot[chamUnit.group] != CHAMELEON_NO_SLOT );
 
-	/* excluding members of groups marked for excluding */
-	if( !exclude && chamUnit.group != 0 ) {
-	  for( i=0; excludedGroups[i] != 0 && 			/* end of list? */
-		 i < CHAMELEON_BBIS_MAX_GRPS - 1; i++)
-	    {
-	      if( excludedGroups[i] == chamUnit.group ) {
-		exclude = 1;
-		break;
-	      }
-	    }
-	}
+      /* no group OR base device of group not yet included:
+	 excluding specified devIds */
+      if( !exclude && ((chamUnit.group == 0) || (groupBaseDevIncluded == 0)) &&
+	  h->exclDevIds && BITMAP_TST( h->exclDevIds, chamUnit.devId ) ){
+	DBGWRT_2((DBH," unit %d: devId=0x%x excluded\n", u, chamUnit.devId ));
+
+	exclude = 1;
+	/* group, exclude also rest of group members */
+	if( chamUnit.group != 0 )
+	  grpSlot[chamUnit.group] = CHAMELEON_GRP_EXCL;
       }
 
       /* module should be used? no group */
@@ -957,41 +1395,20 @@ static int32 CHAMELEON_BrdInit(
 	  DBGWRT_2(( DBH, " DEVICE_IDV2_%d = 0x%x\n",
 		     h->devCount, chamUnit.devId ));
 
-	  h->dev[h->devCount] = OSS_MemGet( h->osHdl,
-					    sizeof(CHAMELEONV2_UNIT),
-					    &h->devGotSize[h->devCount]);
-	  if( !h->dev[h->devCount] ) {
-	    DBGWRT_ERR((DBH, "*** %s_Init: no ressources f. chamUnit\n", BBNAME));
-	    error = ERR_OSS_MEM_ALLOC;
-	    goto ABORT;
-	  }
+	  /* moved to unit arena below */
+	  h->dev[h->devCount] = &snap.unit[u];
 	  h->devId[h->devCount] = chamUnit.devId;
-
-	  OSS_MemCopy( h->osHdl, sizeof( chamUnit ),
-		       (char*)&chamUnit,
-		       (char*)h->dev[h->devCount]);
+	  h->used[h->usedNum++] = (u_int16)h->devCount;
 	  h->devCount++;
 	  /* module should be used? group */
 	} else if( !exclude ) {
 	/* group already existant? */
-	for( n=0; n < h->devCount; n++) {
-	  if( h->devId[n] == CHAMELEON_BBIS_GROUP &&
-	      ((BBIS_CHAM_GRP *)h->dev[n])->grpId == chamUnit.group)
+	if( groupBaseDevIncluded )
 	    {
-	      lGrp = (BBIS_CHAM_GRP *)h->dev[n];
-	      if( lGrp->devCount < CHAMELEON_BBIS_MAX_DEVS ) {
+	      lGrp = (BBIS_CHAM_GRP *)h->dev[grpSlot[chamUnit.group]];
+	      if( lGrp->devCount < lGrp->memberNum ) {
 		/* attach module to group */
-		lGrp->dev[lGrp->devCount] = OSS_MemGet( h->osHdl,
-							sizeof(CHAMELEONV2_UNIT),
-							&lGrp->devGotSize[lGrp->devCount]);
-		if( !lGrp->dev[lGrp->devCount] ) {
-		  DBGWRT_ERR((DBH, "*** %s_Init: no ressources f. chamUnit in group\n", BBNAME));
-		  error = ERR_OSS_MEM_ALLOC;
-		  goto ABORT;
-		}
-		OSS_MemCopy( h->osHdl, sizeof( chamUnit ),
-			     (char*)&chamUnit,
-			     (char*)lGrp->dev[lGrp->devCount]);
+		lGrp->dev[lGrp->devCount] = &snap.unit[u];
 		lGrp->devId[lGrp->devCount] = chamUnit.devId;
 		lGrp->devCount++;
 		DBGWRT_2(( DBH, " GROUP_%d/DEVICE_IDV2_%d = 0x%x\n",
@@ -1000,64 +1417,48 @@ static int32 CHAMELEON_BrdInit(
 		DBGWRT_ERR((DBH, "*** %s_BrdInit: too many devices"
 			    " in group %d\n", BBNAME, lGrp->grpId));
 	      }
-	      break;
 	    }
-	}
-
-	if( n == h->devCount &&
-	    h->devCount < CHAMELEON_BBIS_MAX_DEVS )
+	else if( h->devCount < CHAMELEON_BBIS_MAX_DEVS )
 	  {
-	    /* no group yet for this module, get mem for new group */
-	    h->dev[h->devCount] = (BBIS_CHAM_GRP *)OSS_MemGet( h->osHdl,
-							       sizeof( BBIS_CHAM_GRP ),
-							       &h->devGotSize[h->devCount]);
-	    if( !h->dev[h->devCount] ) {
-	      DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources\n",
-			  BBNAME));
+	    /* no group yet for this module, get mem for new group
+	       sized to the group members in the table */
+	    lGrp = GrpAlloc( h, h->devCount, chamUnit.group,
+			     grpNum[chamUnit.group] );
+	    if( !lGrp ) {
 	      error = ERR_OSS_MEM_ALLOC;
 	      goto ABORT;
 	    }
-	    OSS_MemFill( h->osHdl, sizeof( BBIS_CHAM_GRP ), (char*)h->dev[h->devCount], 0x00 );
-
-	    lGrp = (BBIS_CHAM_GRP*)h->dev[h->devCount];
-	    lGrp->grpId    = chamUnit.group;
-	    for( i=0; i<CHAMELEON_BBIS_MAX_DEVS; i++ ) {
-	      lGrp->devId[i]      = CHAMELEON_NO_DEV;
-	    }
-
+	    h->used[h->usedNum++] = (u_int16)h->devCount;
 
 	    /* anounce group */
 	    h->devId[h->devCount] = CHAMELEON_BBIS_GROUP;
+	    grpSlot[chamUnit.group] = (u_int16)h->devCount;
 	    h->devCount++;
 
 	    /* add module to new group */
-	    lGrp->dev[0] = OSS_MemGet( h->osHdl,
-				       sizeof(CHAMELEONV2_UNIT),
-				       &lGrp->devGotSize[0]);
-	    if( !lGrp->dev[0] ) {
-	      DBGWRT_ERR((DBH, "*** %s_Init: no ressources f. chamUnit in group\n", BBNAME));
-	      error = ERR_OSS_MEM_ALLOC;
-	      goto ABORT;
-	    }
-	    OSS_MemCopy( h->osHdl, sizeof( CHAMELEONV2_UNIT ),
-			 (char*)&chamUnit,
-			 (char*)lGrp->dev[0]);
+	    lGrp->dev[0] = &snap.unit[u];
 	    lGrp->devId[0] = chamUnit.devId;
 	    lGrp->devCount = 1;
 	    DBGWRT_2(( DBH, " GROUP_%d/DEVICE_IDV2_%d = 0x%x\n", chamUnit.group, 1, chamUnit.devId ));
 	  }
       }
     }
-  } else {
+
+    /* size slot tables to slots used */
+    if( (error = SlotTblResize( h, h->devCount )) )
+      goto ABORT;
+  } else if( !h->lazyEnum ) {
     /* locate modules */
     CHAMELEONV2_FIND	chamFind;
     int idx;
+    u_int32 s;
 
     chamFind.variant  = -1;
     chamFind.busId    = -1;
     chamFind.bootAddr = -1;
 
-    for( i=0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ){
+    for( s=0; s < h->usedNum; s++ ){
+      i = h->used[s];
 
       if( h->devId[i] == CHAMELEON_NO_DEV )
 	continue;
@@ -1070,25 +1471,14 @@ static int32 CHAMELEON_BrdInit(
 	  chamFind.group = (int16)lGrp->grpId;
 	  chamFind.instance = -1; /* not used, instead use index of dev */
 
-	  for( n=0; n < lGrp->devCount && n < CHAMELEON_BBIS_MAX_DEVS; n++ ){
+	  for( n=0; n < lGrp->devCount; n++ ){
 	    chamFind.devId	  = lGrp->devId[n];
 	    idx 			  = lGrp->idx[n];
-
-	    lGrp->dev[n] = OSS_MemGet( h->osHdl,
-				       sizeof(CHAMELEONV2_UNIT),
-				       &lGrp->devGotSize[n]);
-	    if( !lGrp->dev[n] ) {
-	      DBGWRT_ERR((DBH, "*** %s_Init: no ressources f. chamUnit in group\n", BBNAME));
-	      error = ERR_OSS_MEM_ALLOC;
-	      goto ABORT;
-	    }
+	    lGrp->dev[n]	  = NULL;
 
 	    DBGWRT_2((DBH," looking for devId=0x%x grp %d idx %d\n", lGrp->devId[n], lGrp->grpId, idx));
 
-	    if( (chErr = h->chamFuncTbl[h->tblType].InstanceFind(
-								 chamHdl, idx, chamFind,
-								 (CHAMELEONV2_UNIT*)lGrp->dev[n],
-								 NULL, NULL))
+	    if( (chErr = SnapFind( &snap, idx, &chamFind, &unitP ))
 		!= CHAMELEONV2_UNIT_FOUND )
 	      {
 		DBGWRT_ERR((DBH, "*** %s_BrdInit: can't find "
@@ -1098,6 +1488,8 @@ static int32 CHAMELEON_BrdInit(
 		/* flag slot unusuable */
 		h->devId[i] = CHAMELEON_NO_DEV;
 	      }
+	    else
+	      lGrp->dev[n] = unitP;	/* moved to unit arena below */
 	  }
 
 	} else { /* normal device, no group */
@@ -1109,25 +1501,10 @@ static int32 CHAMELEON_BrdInit(
 	DBGWRT_2((DBH," looking for devId=0x%x index %d\n",
 		  chamFind.devId, idx ));
 
-	if( (chErr = h->chamFuncTbl[h->tblType].InstanceFind(
-							     chamHdl, idx, chamFind,
-							     &chamUnit, NULL, NULL))
+	if( (chErr = SnapFind( &snap, idx, &chamFind, &unitP ))
 	    == CHAMELEONV2_UNIT_FOUND )
 	  {
-	    h->dev[i] = OSS_MemGet( h->osHdl,
-				    sizeof( CHAMELEONV2_UNIT ),
-				    &gotSize);
-	    if( !h->dev[i] ) {
-	      DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources\n",
-			  BBNAME));
-	      error = ERR_OSS_MEM_ALLOC;
-	      goto ABORT;
-	    }
-	    h->devGotSize[i] = gotSize;
-
-	    OSS_MemCopy( h->osHdl, sizeof( chamUnit ),
-			 (char*)&chamUnit,
-			 (char*)h->dev[i] );
+	    h->dev[i] = unitP;	/* moved to unit arena below */
 	  } else {
 	  DBGWRT_ERR((DBH, "*** %s_BrdInit: can't find devId=0x%x "
 		      "group 0 instance %d (chErr = 0x%x)\n",
@@ -1138,13 +1515,27 @@ static int32 CHAMELEON_BrdInit(
       }
     }
   }
+
+  /* copy unit info of all slots from snapshot into one memory block */
+  if( !h->lazyEnum && (error = UnitArenaBuild( h )) )
+    goto ABORT;
+
+  /* drop slots that became unusable from occupied slot list */
+  SlotUsedUpdate( h );
+
+  /* precompute interrupt routing (lazy enumeration: see SlotResolve) */
+  for( un=0; un < h->usedNum; un++ )
+    IrqRouteBuild( h, h->used[un] );
+
 #ifdef CHAMELEON_BBIS_DEBUG
   {
-    for( i=0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ){
+    u_int32 s;
+    for( s=0; s < h->usedNum; s++ ){
+      i = h->used[s];
       if( h->devId[i] == CHAMELEON_BBIS_GROUP ){
 	lGrp = (BBIS_CHAM_GRP*)h->dev[i];
-	for( n=0; n < CHAMELEON_BBIS_MAX_DEVS; n++ ){
-	  if( lGrp->devId[n] != CHAMELEON_NO_DEV )
+	for( n=0; n < lGrp->devCount; n++ ){
+	  if( lGrp->devId[n] != CHAMELEON_NO_DEV && lGrp->dev[n] )
 	    {
 	      DBGWRT_2((DBH," DMP: GRP_%d/DEVICE_%d: grpId %d devId 0x%x inst %d addr %08p size 0x%08x\n",
 			i, n, lGrp->grpId,
@@ -1155,7 +1546,7 @@ static int32 CHAMELEON_BrdInit(
 	    }
 	}
       }
-      else if( h->devId[i] != CHAMELEON_NO_DEV )
+      else if( h->devId[i] != CHAMELEON_NO_DEV && h->dev[i] )
 	{
 	  DBGCMD( CHAMELEONV2_UNIT *lUnit = (CHAMELEONV2_UNIT*)h->dev[i] );
 	  DBGWRT_2((DBH," DMP: DEVICE_%d: devId 0x%x inst %d addr %08p size 0x%08x\n",
@@ -1180,51 +1571,26 @@ static int32 CHAMELEON_BrdInit(
     +------------------------------------------------------------*/
   {
     CHAMELEONV2_FIND	_find;
-    CHAMELEONV2_UNIT	_unit;
-    u_int32				irqenLower;
-    u_int32				irqenUpper;
+    CHAMELEONV2_UNIT	*_unit, girqUnit;
 
     OSS_MemFill( h->osHdl, sizeof( _find ), (char*)&_find, 0x00 );
     _find.devId = CHAM_ModCodeToDevId(CHAMELEON_16Z052_GIRQ);
 
     /* get GIRQ address */
-    if( (chErr = h->chamFuncTbl[h->tblType].InstanceFind(
-							 chamHdl, 0, _find, &_unit, NULL, NULL))
-	== CHAMELEONV2_UNIT_FOUND )
+    if( h->lazyEnum ) {
+      _unit = &girqUnit;
+      chErr = h->chamFuncTbl[h->tblType].InstanceFind( chamHdl, 0, _find,
+						       _unit, NULL, NULL );
+    } else
+      chErr = SnapFind( &snap, 0, &_find, &_unit );
+
+    if( chErr == CHAMELEONV2_UNIT_FOUND )
       {
-	h->girqPhysAddr = (char*)_unit.addr;
-	h->girqType = h->chamInfo.ba[_unit.bar].type;
-
-	/* map address - address space MEM and bus type PCI
-	   must be adapted if it will be used for i.e. M199 */
-	error = OSS_MapPhysToVirtAddr( h->osHdl, h->girqPhysAddr,
-				       BBCHAM_GIRQ_SPACE_SIZE,
-				       h->girqType, /* 0=mem, 1=io */
-				       BUSTYPE,
-				       _unit.busId /* pci bus number */,
-				       (void**) &h->girqVirtAddr );
+	/* map or share GIRQ of other handles on this FPGA */
+	error = GirqAttach( h, (char*)_unit->addr,
+			    h->chamInfo.ba[_unit->bar].type, _unit->busId );
 	if( error )
-	  {
-	    DBGWRT_ERR((DBH," *** %s_Init: OSS_MapPhysToVirtAddr() girqPhysAddr %08p failed\n",
-			BBNAME, h->girqPhysAddr ));
-	    goto ABORT;
-	  }/*if*/
-
-	_MREAD_D32(irqenLower, h->girqVirtAddr, BBCHAM_GIRQ_IRQ_EN);
-	_MREAD_D32(irqenUpper, h->girqVirtAddr, BBCHAM_GIRQ_IRQ_EN + 4);
-	_MREAD_D32(h->girqApiVersion, h->girqVirtAddr, BBCHAM_GIRQ_API_VER );
-#ifdef	_BIG_ENDIAN_
-	irqenLower = OSS_SWAP32( irqenLower );
-	irqenUpper = OSS_SWAP32( irqenUpper );
-	h->girqApiVersion = OSS_SWAP32( h->girqApiVersion );
-#endif
-	/* get api version from topmost byte */
-	h->girqApiVersion = h->girqApiVersion >> BBCHAM_GIRQ_API_VER_OFF;
-
-	DBGWRT_1((DBH, "%s_BrdInit: girq found at phys %08p virt %08p - "
-		  "IRQEN current setting %08x %08x, api version 0x%08x\n",
-		  BBNAME, h->girqPhysAddr, h->girqVirtAddr, irqenLower,
-		  irqenUpper, h->girqApiVersion ));
+	  goto ABORT;
       }
     else
       {
@@ -1232,24 +1598,42 @@ static int32 CHAMELEON_BrdInit(
       }
   }
 
+  /* lazy enumeration: keep table open for lookups */
+  if( h->lazyEnum ) {
+    h->chamHdl = chamHdl;
+    chamHdl = NULL;
+  }
+
  ABORT:
+  /* on error, don't keep pointers into the snapshot */
+  if( error )
+    UnitArenaFree( h );
+  else if( snap.num ) {
+    /* new enumeration done, keep fingerprint */
+    h->fpTbl       = tbl;
+    h->fpUnitNum   = snap.num;
+    h->brdInitDone = 1;
+  }
+
+  /* release group map and table snapshot */
+  if( grpSlot )
+    OSS_MemFree( h->osHdl, grpSlot, grpSlotGotSize );
+  SnapFree( h, &snap );
+
   /* when chameleon library initialized: terminate it */
   if( chamHdl )
     h->chamFuncTbl[h->tblType].Term( &chamHdl );
 
  ABORT_NO_CHAM:
-  if( (error != ERR_SUCCESS) &&
-      h->girqVirtAddr )
-    {
-      /* unmap if it was mapped before */
-      int32 err2 = OSS_UnMapVirtAddr( h->osHdl, (void**)&h->girqVirtAddr,
-				      BBCHAM_GIRQ_SPACE_SIZE, h->girqType );
-      if( err2 )
-	{
-	  DBGWRT_ERR((DBH,"*** %s_Init: OSS_UnMapVirtAddr() girqVirtAddr %08p failed\n",
-		      BBNAME, h->girqVirtAddr ) );
-	}
-    }
+  /* on error, nothing of the last call is kept either: alarms stopped,
+     GIRQ detached (unmapped if last user), next call enumerates again */
+  if( error != ERR_SUCCESS )
+    CHAMELEON_BrdExit( h );
+
+  /* write enables deferred so far, alarm retries on failure */
+  if( (error == ERR_SUCCESS) &&
+      h->girq && h->irqEnDefer )
+    GirqFlush( h );
 
   return error;
 }
@@ -1269,38 +1653,36 @@ static int32 CHAMELEON_BrdExit(
 			       BBIS_HANDLE     *h )
 {
   int32 error = 0;
-  u_int32 i,j;
-  BBIS_CHAM_GRP *lGrp;
   DBGWRT_1((DBH, "BB - %s_BrdExit\n",BBNAME));
 
-  if( h->girqVirtAddr )
-    {
-      error = OSS_UnMapVirtAddr( h->osHdl, (void**)&h->girqVirtAddr,
-				 BBCHAM_GIRQ_SPACE_SIZE, h->girqType );
-      if( error )
-	{
-	  DBGWRT_ERR((DBH,"*** %s_Init: OSS_UnMapVirtAddr() girqVirtAddr %08p failed\n",
-		      BBNAME, h->girqVirtAddr ) );
-	  goto CLEANUP;
-	}
-    }
+  /* next *_BrdInit must enumerate again */
+  h->brdInitDone = 0;
+
+  /* lazy enumeration: close table */
+  if( h->chamHdl )
+    h->chamFuncTbl[h->tblType].Term( &h->chamHdl );
+
+  /* moderation/deferred enables: no write after GIRQ is unmapped */
+  if( h->irqModAlm ) {
+    OSS_AlarmClear( h->osHdl, h->irqModAlm );
+    h->irqModArmed = 0;
+  }
+  if( h->irqEnAlm ) {
+    OSS_AlarmClear( h->osHdl, h->irqEnAlm );
+    h->irqEnArmed = 0;
+  }
+
+  /* detach from GIRQ, unmapped by last handle */
+  if( h->girq &&
+      (error = GirqDetach( h )) )
+    goto CLEANUP;
 
   /*---------------------------------+
     |  free memory alloced by BrdInit |
     +--------------------------------*/
-  /* release memory for devices and groups */
-  for( i = 0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ) {
-    if( h->devId[i] == CHAMELEON_BBIS_GROUP ) {
-      /* free dev[] in group */
-      lGrp = (BBIS_CHAM_GRP*)h->dev[i];
-      for( j = 0; j < CHAMELEON_BBIS_MAX_DEVS; j++ ) {
-    	  if( lGrp->dev[j] ){
-    		  OSS_MemFree(h->osHdl, lGrp->dev[j], lGrp->devGotSize[j]);
-    		  lGrp->dev[j] = NULL;
-    	  }
-      }
-    }
-  }
+  /* release unit info of devices and groups */
+  UnitArenaFree( h );
+
  CLEANUP:
   return( error );
 }
@@ -1579,7 +1961,7 @@ static int32 CHAMELEON_CfgInfo(
     	  return ERR_BBIS_ILL_PARAM; /*safe, no resources allocated till here */
       }
 
-      if (h->devId[mSlot] == CHAMELEON_NO_DEV )
+      if ( SlotUnused(h,mSlot) )
     	  status = ERR_BBIS_ILL_SLOT;
       else
 	/* PCIbus */
@@ -1604,7 +1986,7 @@ static int32 CHAMELEON_CfgInfo(
     	  return ERR_BBIS_ILL_PARAM; /*safe, no resources allocated till here */
       }
 
-      if ( (h->devId[mSlot] == CHAMELEON_NO_DEV ))
+      if ( SlotUnused(h,mSlot) )
 	status = ERR_BBIS_ILL_SLOT;
       else
 	/* PCIbus */
@@ -1631,94 +2013,24 @@ static int32 CHAMELEON_CfgInfo(
     	  return ERR_BBIS_ILL_PARAM; /*safe, no resources allocated till here */
       }
 
-      if (h->devId[mSlot] == CHAMELEON_NO_DEV )
+      if ( SlotUnused(h,mSlot) )
       {
     	  status = ERR_BBIS_ILL_SLOT;
       }
       else {
-	u_int16 chamTblInt=0;
+	BBIS_CHAM_IRQ *r = &h->irq[mSlot];
 
-	/* predefine to not BBIS_IRQ_NONE that if condition below works */
-	*mode = !BBIS_IRQ_NONE;
+	/* precomputed by IrqRouteBuild() */
+	*mode   = r->mode;
+	*level  = r->level;
+	*vector = r->vector;
 
-	if( h->devId[mSlot] == CHAMELEON_BBIS_GROUP )
-	  chamTblInt = ((CHAMELEONV2_UNIT*)((BBIS_CHAM_GRP*)h->dev[mSlot])->dev[0])->interrupt;
-	else if( h->devId[mSlot] != CHAMELEON_NO_DEV )
-	  chamTblInt = ((CHAMELEONV2_UNIT *)h->dev[mSlot])->interrupt;
-
-	/* module does not have interrupt possibilities? */
-	if( chamTblInt == 0x3F ){
-	  *mode = BBIS_IRQ_NONE;
-	}
-	/* using irq level from chameleon table (may be overwritten below!) */
-	else {
-	  *level = chamTblInt;
-	}
-
-	/* ISA variant */
-#ifdef CHAM_ISA
-	/* IRQ_NUMBER specified in descriptor? */
-	if( h->isaIrqNbr != TABLE_IRQ ){
-	  /*
-	   * Use irq level from descriptor key IRQ_NUMBER
-	   * instead from table inside FPGA.
-	   */
-
-	  /* interrupt connected? */
-	  if( h->isaIrqNbr ){
-	    *level = h->isaIrqNbr;
-	  }
-	  /* no interrupt */
-	  else{
-	    *mode = BBIS_IRQ_NONE;
-	  }
-	}
-
-	/* interrupt used? */
-	if( *mode != BBIS_IRQ_NONE ){
-
-	  // share always (for ser IRQs at SC24 LPC bus)
-	  *mode = BBIS_IRQ_SHARED;
-
-	  /* maybe an alternative? */
-#if 0
-	  /* non shared legacy IRQ0..15? */
-	  if( *level < 16 )
-	    *mode = BBIS_IRQ_EXCLUSIVE;
-	  /* shared IRQ16..max */
-	  else
-	    *mode = BBIS_IRQ_SHARED;
-#endif
-	}
-
-	/* default (PCI variant) */
-#else
-	*mode = BBIS_IRQ_SHARED;
-
-#ifdef CHAMELEON_USE_PCITABLE
-	/*
-	 * Take irq level from PCI config space instead from
-	 * table inside FPGA (normal use case, except e.g. EM08).
-	 */
-	OSS_PciGetConfig( h->osHdl,
-			  OSS_MERGE_BUS_DOMAIN(h->pciBusNbr, h->pciDomainNbr),
-			  h->pciDevNbr, 0, OSS_PCI_INTERRUPT_LINE, (int32*)level );
-
-	/* no interrupt available ? */
-	if ( *level == 0xff )
-	  *mode = BBIS_IRQ_NONE;
-#endif /* CHAMELEON_USE_PCITABLE */
-
-#endif
-	OSS_IrqLevelToVector( h->osHdl, BUSTYPE,
-			      *level, (int32 *)vector );
-
-	DBGWRT_2((DBH, " mSlot=%d : IRQ mode=0x%x,"
-		  " level=0x%x, vector=0x%x\n",
-		  mSlot, *mode, *level, *vector));
-      }
-      break;
-    }
+	DBGWRT_2((DBH, " mSlot=%d : IRQ mode=0x%x,"
+		  " level=0x%x, vector=0x%x\n",
+		  mSlot, *mode, *level, *vector));
+      }
+      break;
+    }
 
     /* exception interrupt information */
   case BBIS_CFGINFO_EXP:
@@ -1754,7 +2066,7 @@ static int32 CHAMELEON_CfgInfo(
     		break;
       }
 
-      if (h->devId[mSlot] == CHAMELEON_NO_DEV ) {
+      if ( SlotUnused(h,mSlot) ) {
     	  status = ERR_BBIS_ILL_SLOT;
     	  break;
       }
@@ -1786,6 +2098,11 @@ static int32 CHAMELEON_CfgInfo(
  *
  *  Description:  Chameleon BBIS Interrupt enable / disable for the unit.
  *
+ *                Sets or clears the slot's bit in the GIRQ IRQ_EN register,
+ *                see GirqUpdate(). Units without interrupt are ignored.
+ *                With IRQ_EN_DEFER, enabling is delayed until the next
+ *                flush.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  h			pointer to board handle structure
  *                slot      unit slot number
@@ -1800,156 +2117,40 @@ static int32 CHAMELEON_IrqEnable(
 {
   DBGCMD(	static const char functionName[] = "_IrqEnable:"; )
   int32	error = 0;
-  u_int32 irqen = 0x00000000;
-  u_int32 irqenLittleEndian = 0x00000000;
-  u_int32 irqen_readback = 0x00000000;
-  int i = 0;
-  int slotShift;
+  BBIS_CHAM_IRQ *r;
+  u_int32 setMask[2] = { 0, 0 };
+  u_int32 clrMask[2] = { 0, 0 };
 
   DBGWRT_1((DBH, "BB - %s %s: slot=%d; enable=%d\n", BBNAME,functionName,slot,enable ));
 
-  if( h->girqVirtAddr )
+  if( h->girq )
     {
-
-      int			offs		= 0;
-      u_int32		girqInUse	= 0; /* GIRQ hardware Spin Lock */
-
-      if( h->devId[slot] == CHAMELEON_BBIS_GROUP )
-	slotShift = ((CHAMELEONV2_UNIT*)((BBIS_CHAM_GRP*)h->dev[slot])->dev[0])->interrupt;
-      else if( h->devId[slot] != CHAMELEON_NO_DEV )
-	slotShift = ((CHAMELEONV2_UNIT *)h->dev[slot])->interrupt;
-      else
+      if( SlotUnused(h,slot) )
 	{
 	  error = ERR_BBIS_ILL_IRQPARAM;
 	  DBGWRT_ERR((DBH, "*** BB - %s%s: no CHAMELEON_BBIS_GROUP\n", BBNAME,functionName ));
 	  goto CLEANUP;
 	}
 
-      /* upper 32 bit ? */
-      if( slotShift > 31 )
+      r = &h->irq[slot];
+      if( !r->mask || (enable && (r->flags & CHAM_IRQ_POLL)) )
 	{
-	  /* next address - irq enable has 64 bit */
-	  offs 		= 4;
-	  slotShift  -= 32;
-	}
-
-      /* lock critical section by spinlock to be multiprocessor safe */
-      error = OSS_SpinLockAcquire( h->osHdl, h->slHdl );
-      if (error)
-	{
-	  DBGWRT_ERR((DBH, "*** BB - %s%s: OSS_SpinLockAcquire() failed!"
-		      "Error 0x%0x\n",
-		      BBNAME, functionName, error ));
+	  DBGWRT_1((DBH, "BB - %s%s: slot=%d has no interrupt or is polled\n",
+		    BBNAME, functionName, slot ));
 	  goto CLEANUP;
 	}
 
-      /* GIRQ INUSE_STS bit available */
-      if ( h->girqApiVersion ) {
-	u_int32 girqCount = 0;
-
-	/* check INUSE bit */
-	_MREAD_D32(girqInUse, h->girqVirtAddr, BBCHAM_GIRQ_IN_USE);
-#ifdef  _BIG_ENDIAN_
-	girqInUse = OSS_SWAP32( girqInUse );
-#endif
-	/* GIRQ INUSE bit is 0 when no other device uses the register
-	 * if bit is 1 wait until released
-	 * release INUSE bit by writing 1 to the register
-	 */
-	while ( (girqInUse & BBCHAM_GIRQ_IN_USE_BIT) )
-	  {
-	    girqCount++;
-	    DBGWRT_2((DBH, " GIRQ INUSE retry! count=%d\n",
-		      girqCount ));
-
-	    OSS_MikroDelay(h->osHdl, 10 );
-
-	    /* check INUSE bit */
-	    _MREAD_D32(girqInUse, h->girqVirtAddr, BBCHAM_GIRQ_IN_USE);
-#ifdef	_BIG_ENDIAN_
-	    girqInUse = OSS_SWAP32( girqInUse );
-#endif
-	  }
-
-	DBGWRT_1((DBH, "BB - %s%s: GIRQ INUSE bit taken. Retry count=%0d\n",
-		  BBNAME, functionName, girqCount ));
-      }
-
-      /* Verify and re-write if BBCHAM_GIRQ_IRQ_EN has changed in the meantime
-       * This problem occured with async use of vxbmengirq, which can overwrite the BBCHAM_GIRQ_IRQ_EN register
-       */
-      for(i=0; i<10; i++)
-      {
-          /* set/reset slot corresponding irq enable bit */
-          _MREAD_D32(irqen, h->girqVirtAddr, BBCHAM_GIRQ_IRQ_EN + offs);
-
-#ifdef	_BIG_ENDIAN_
-          irqenLittleEndian = OSS_SWAP32( irqen );
-#else
-          irqenLittleEndian = irqen;
-#endif
-
-          if( enable )
-          {
-	    irqenLittleEndian |= (0x00000001 << (slotShift));
-          }
-          else
-          {
-	    irqenLittleEndian &= ~(0x00000001 << (slotShift));
-	  }
-
-#ifdef _BIG_ENDIAN_
-          irqen = OSS_SWAP32( irqenLittleEndian );
-#else
-          irqen = irqenLittleEndian;
-#endif
-
-          _MWRITE_D32(h->girqVirtAddr, BBCHAM_GIRQ_IRQ_EN + offs, irqen);
-
-          /* wait and verify */
-	  OSS_MikroDelay(h->osHdl, 100 );
-	   _MREAD_D32(irqen_readback, h->girqVirtAddr, BBCHAM_GIRQ_IRQ_EN + offs);
-
-	  if( irqen_readback == irqen )
-	  {
-	    break;
-	  }
-	  else
-	  {
-            DBGWRT_ERR((DBH, "*** BB - %s%s: BBCHAM_GIRQ_IRQ_EN has been overwritten, retry #%d\n", BBNAME,functionName, i ));
-	  }
-      }
-      if( i >= 10 )
-      {
-        DBGWRT_ERR((DBH, "*** BB - %s%s: unable to set BBCHAM_GIRQ_IRQ_EN correctly!\n", BBNAME,functionName));
-      }
-
-      /* GIRQ INUSE_STS bit available */
-      if ( h->girqApiVersion ) {
-
-	/* set current bit for release */
-	girqInUse = BBCHAM_GIRQ_IN_USE_BIT;
-#ifdef _BIG_ENDIAN_
-	girqInUse = OSS_SWAP32( girqInUse );
-#endif
-
-	/* release INUSE bit */
-	_MWRITE_D32(h->girqVirtAddr, BBCHAM_GIRQ_IN_USE, girqInUse);
-	DBGWRT_1((DBH, "BB - %s%s: GIRQ INUSE bit released.\n",
-		  BBNAME, functionName ));
-      }
+      /* irq enable has 64 bit */
+      if( enable )
+	setMask[r->offs / 4] = r->mask;
+      else
+	clrMask[r->offs / 4] = r->mask;
 
-      /* release spinlock */
-      error = OSS_SpinLockRelease(h->osHdl, h->slHdl);
-      if (error)
-	{
-	  DBGWRT_ERR((DBH, "*** BB - %s%s: OSS_SpinLockRelease() failed!"
-    			  "Error 0x%0x\n", BBNAME, functionName, error ));
-	  goto CLEANUP;
-	}
+      if( (error = GirqUpdate( h, setMask, clrMask, GIRQ_UPD_ENABLE )) )
+	goto CLEANUP;
 
-      DBGWRT_1((DBH, "BB - %s%s: slot=%d enable=%d GIRQ @%08p is %08x slotShift %d\n", BBNAME,functionName,
-		slot, enable, h->girqPhysAddr+BBCHAM_GIRQ_IRQ_EN+offs, irqenLittleEndian, slotShift ));
+      DBGWRT_1((DBH, "BB - %s%s: slot=%d enable=%d GIRQ @%08p is %08x %08x mask %08x\n", BBNAME,functionName,
+		slot, enable, h->girq->physAddr+BBCHAM_GIRQ_IRQ_EN+r->offs, h->girq->en[0], h->girq->en[1], r->mask ));
     }
 
  CLEANUP:
@@ -1960,28 +2161,73 @@ static int32 CHAMELEON_IrqEnable(
  *
  *  Description:  Called at the beginning of an interrupt.
  *
- *                Do nothing
+ *                If the FPGA has a GIRQ unit, the half of the interrupt
+ *                request register holding the slot's interrupt bit is read
+ *                to tell whether the unit requests an interrupt.
+ *                Without GIRQ or unit interrupt, BBIS_IRQ_UNK is returned
+ *                and the device driver has to check its unit itself.
+ *
+ *                When CHAMELEON_MA_IRQ_PEND was requested, both halves
+ *                are read instead (one access with CHAMELEON_GIRQ_D64)
+ *                and published there, so the copy the child driver sees
+ *                is never partly from an earlier interrupt.
+ *
+ *                With IRQ_PRIO, a requesting slot answers BBIS_IRQ_NO
+ *                while an enabled GIRQ bit of a higher level is pending,
+ *                see IrqPrioAbove(). The higher slots are serviced first,
+ *                the line fires again for the slot (not with
+ *                CHAMELEON_USE_A21_MSI).
  *
  *---------------------------------------------------------------------------
  *  Input......:  h			pointer to board handle structure
  *                mSlot     module slot number
- *  Output.....:  return    BBIS_IRQ_UNK
+ *  Output.....:  return    BBIS_IRQ_YES | BBIS_IRQ_NO | BBIS_IRQ_UNK
  *  Globals....:  ---
  ****************************************************************************/
 static int32 CHAMELEON_IrqSrvInit(
 				  BBIS_HANDLE     *h,
 				  u_int32         mSlot)
 {
+  BBIS_CHAM_IRQ *r;
+  CHAMELEON_IRQ_PEND *pend = h->irqPend;
+  u_int32 irqreq[2], *req = irqreq;
+  int half, num = 1;
+
   IDBGWRT_1((DBH, "BB - %s_IrqSrvInit: mSlot=%d\n", BBNAME, mSlot ));
 
-  return BBIS_IRQ_UNK;
+  if( !h->girq || mSlot >= h->slotNum || !(r = &h->irq[mSlot])->mask )
+    return BBIS_IRQ_UNK;
+
+  half = r->offs / 4;
+
+  /* read and publish both halves for child drivers */
+  if( pend ) {
+    req = pend->req;
+    num = 2;
+  }
+  GirqRegRead( h, BBCHAM_GIRQ_IRQ_REQ, num == 2 ? 0 : half, num, req );
+
+  if( !(req[half] & r->mask) )
+    return BBIS_IRQ_NO;
+
+#ifdef CHAM_IRQ_PRIO_DEFER
+  /* higher IRQ_PRIO first, serviced at the next interrupt */
+  if( h->irqPrio && IrqPrioAbove( h, mSlot, req, num ) )
+    return BBIS_IRQ_NO;
+#endif
+
+  if( r->flags & CHAM_IRQ_MOD )
+    IrqModerate( h, r );
+
+  return BBIS_IRQ_YES;
 }
 
 /****************************** CHAMELEON_IrqSrvExit *************************
  *
  *  Description:  Called at the end of an interrupt.
  *
- *                Do nothing
+ *                Clears the slot's bit in the published IRQ_REQ, see
+ *                CHAMELEON_MA_IRQ_PEND.
  *
  *---------------------------------------------------------------------------
  *  Input......:  h			pointer to board handle structure
@@ -1994,6 +2240,10 @@ static void CHAMELEON_IrqSrvExit(
 				 u_int32         mSlot )
 {
   IDBGWRT_1((DBH, "BB - %s_IrqSrvExit: mSlot=%d\n", BBNAME, mSlot ));
+
+  /* request serviced, not pending for readers of the copy */
+  if( h->irqPend && mSlot < h->slotNum )
+    h->irqPend->req[h->irq[mSlot].offs / 4] &= ~h->irq[mSlot].mask;
 }
 
 /****************************** CHAMELEON_ExpEnable **************************
@@ -2097,6 +2347,8 @@ static int32 CHAMELEON_ClrMIface(
  *  Input......:  h			pointer to board handle structure
  *                mSlot     module slot number
  *                addrMode  single device: ignored, group: MDIS_MA_CHAMELEON
+ *                          CHAMELEON_MA_IRQ_PEND: RAM copy of GIRQ IRQ_REQ,
+ *                          see IrqPendMap()
  *                dataMode  single device: ignored, group: MDIS_MD_CHAM_n
  *                mAddr     pointer to address space
  *                mSize     size of address space
@@ -2118,9 +2370,13 @@ static int32 CHAMELEON_GetMAddr(
   if ( mSlot > CHAMELEON_BBIS_MAX_DEVS - 1 )
 	  return ERR_BBIS_ILL_SLOT;
 
-  if ( h->devId[mSlot] == CHAMELEON_NO_DEV )
+  if ( SlotUnused(h,mSlot) )
 	  return ERR_BBIS_ILL_SLOT;
 
+  /* pending interrupts in RAM, same for all slots */
+  if( addrMode == CHAMELEON_MA_IRQ_PEND )
+    return IrqPendMap( h, mAddr, mSize );
+
   /* group device? */
   if( h->devId[mSlot] == CHAMELEON_BBIS_GROUP ) {
     if( ( addrMode != MDIS_MA_CHAMELEON ) && ( addrMode != MDIS_MA_BB_INFO_PTR ) ) {
@@ -2128,7 +2384,8 @@ static int32 CHAMELEON_GetMAddr(
 		  BBNAME, addrMode));
       return ERR_BBIS_ILL_ADDRMODE;
     }
-    if( dataMode > MDIS_MD_CHAM_MAX ) {
+    if( dataMode > MDIS_MD_CHAM_MAX ||
+	dataMode >= (u_int32)((BBIS_CHAM_GRP *)h->dev[mSlot])->devCount ) {
       DBGWRT_ERR((DBH,"*** %s_GetMAddr: ill data mode=0x%x for group!\n",
 		  BBNAME, dataMode));
       return ERR_BBIS_ILL_DATAMODE;
@@ -2186,6 +2443,15 @@ static int32 CHAMELEON_GetMAddr(
  *                Code                 Description                Values
  *                -------------------  -------------------------  ----------
  *                M_BB_DEBUG_LEVEL     board debug level          see dbg.h
+ *                CHAMELEON_IRQ_EN_FLUSH  write deferred enables  -
+ *                CHAMELEON_BLK_IRQ_EN    set/clear GIRQ bits     see below
+ *                CHAMELEON_BLK_IRQ_SLOTS en/disable slot irqs    see below
+ *
+ *                CHAMELEON_BLK_IRQ_EN takes a CHAMELEON_IRQ_EN_BLK with
+ *                masks of GIRQ bits to set and clear. CHAMELEON_BLK_IRQ_SLOTS
+ *                takes an u_int32 array of slot numbers, ORed with
+ *                CHAMELEON_IRQ_SLOT_EN to enable the slot's interrupt.
+ *                Both apply all changes with one lock/INUSE handshake.
  *
  *---------------------------------------------------------------------------
  *  Input......:  h				pointer to board handle structure
@@ -2212,6 +2478,19 @@ static int32 CHAMELEON_SetStat(
     h->debugLevel = value;
     break;
 
+    /* write deferred interrupt enables */
+  case CHAMELEON_IRQ_EN_FLUSH:
+    if( !h->girq ) {
+      DBGWRT_ERR((DBH, "*** %s_SetStat: no GIRQ unit\n", BBNAME ));
+      return ERR_BBIS_ILL_FUNC;
+    }
+    return GirqFlush( h );
+
+    /* bulk interrupt enable/disable */
+  case CHAMELEON_BLK_IRQ_EN:
+  case CHAMELEON_BLK_IRQ_SLOTS:
+    return IrqEnableBlk( h, code, (M_SG_BLOCK*)value32_or_64 );
+
     /* unknown */
   default:
     return ERR_BBIS_UNK_CODE;
@@ -2230,6 +2509,24 @@ static int32 CHAMELEON_SetStat(
  *                -------------------  -------------------------  ----------
  *                M_BB_DEBUG_LEVEL     driver debug level         see dbg.h
  *                M_MK_BLK_REV_ID      ident function table ptr   -
+ *                CHAMELEON_BLK_GIRQ_STATS GIRQ INUSE statistics  see below
+ *
+ *                CHAMELEON_BLK_IRQ_PENDING pending polled slots  see below
+ *                CHAMELEON_BLK_IRQ_ORDER pending slots by prio   see below
+ *
+ *                CHAMELEON_BLK_GIRQ_STATS returns a CHAMELEON_GIRQ_STATS
+ *                with the counters of the GIRQ INUSE hardware lock.
+ *
+ *                CHAMELEON_BLK_IRQ_PENDING reads the GIRQ request register
+ *                once and returns an u_int32 bitmap (bit n%32 of word n/32
+ *                for slot n) of the IRQ_POLL_SLOTS slots requesting an
+ *                interrupt. Data size must be at least 4 byte, slots
+ *                beyond the data size are not reported.
+ *
+ *                CHAMELEON_BLK_IRQ_ORDER reads the GIRQ request register
+ *                once and returns an u_int32 array of the slots requesting
+ *                an interrupt, highest IRQ_PRIO first. Size is set to the
+ *                size used, slots beyond the data size are not reported.
  *
  *---------------------------------------------------------------------------
  *  Input......:  h					pointer to board handle structure
@@ -2260,6 +2557,39 @@ static int32 CHAMELEON_GetStat(
     *value32_or_64P = (INT32_OR_64)&h->idFuncTbl;
     break;
 
+    /* GIRQ INUSE statistics (of all handles on the FPGA) */
+  case CHAMELEON_BLK_GIRQ_STATS:
+    {
+      M_SG_BLOCK *blk = (M_SG_BLOCK*)value32_or_64P;
+      int32 error;
+
+      if( blk->size < (int32)sizeof(CHAMELEON_GIRQ_STATS) )
+	return ERR_BBIS_ILL_PARAM;
+
+      if( !h->girq ) {
+	DBGWRT_ERR((DBH, "*** %s_GetStat: no GIRQ unit\n", BBNAME ));
+	return ERR_BBIS_ILL_FUNC;
+      }
+
+      /* consistent copy */
+      if( (error = OSS_SpinLockAcquire( h->osHdl, h->girq->slHdl )) )
+	return error;
+      OSS_MemCopy( h->osHdl, sizeof(CHAMELEON_GIRQ_STATS),
+		   (char*)&h->girq->stats, (char*)blk->data );
+      OSS_SpinLockRelease( h->osHdl, h->girq->slHdl );
+
+      blk->size = sizeof(CHAMELEON_GIRQ_STATS);
+      break;
+    }
+
+    /* pending polled slots */
+  case CHAMELEON_BLK_IRQ_PENDING:
+    return IrqPending( h, (M_SG_BLOCK*)value32_or_64P );
+
+    /* pending slots in dispatch order */
+  case CHAMELEON_BLK_IRQ_ORDER:
+    return IrqOrder( h, (M_SG_BLOCK*)value32_or_64P );
+
     /* unknown */
   default:
     return ERR_BBIS_UNK_CODE;
@@ -2314,7 +2644,6 @@ static int32 Cleanup(
 		     int32        retCode		/* nodoc */
 		     )
 {
-  u_int32 i;
   u_int32 error =0;
   DBGWRT_1((DBH, "BB - %s_Cleanup\n",BBNAME));
 
@@ -2325,14 +2654,31 @@ static int32 Cleanup(
   if (h->descHdl)
     DESC_Exit(&h->descHdl);
 
-  /* remove spinlock */
-  if (h->slHdl) {
-    error = OSS_SpinLockRemove(h->osHdl, &h->slHdl);
+  /* remove moderation and deferred enable alarms */
+  if( h->irqModAlm )
+    OSS_AlarmRemove( h->osHdl, &h->irqModAlm );
+  if( h->irqEnAlm )
+    OSS_AlarmRemove( h->osHdl, &h->irqEnAlm );
+
+  /* detach from GIRQ (if BrdExit not called) */
+  if( h->girq ) {
+    error = GirqDetach( h );
+    if ( error ) {
+      DBGWRT_ERR((DBH, "*** BB - %s_Cleanup: GirqDetach() failed! "
+		  "Error 0x%0x!\n", BBNAME, error ));
+    }
+  }
+
+  /* remove lazy enumeration spinlock and semaphore */
+  if( h->slHdl ) {
+    error = OSS_SpinLockRemove( h->osHdl, &h->slHdl );
     if ( error ) {
       DBGWRT_ERR((DBH, "*** BB - %s_Cleanup: OSS_SpinLockRemove() failed! "
 		  "Error 0x%0x!\n", BBNAME, error ));
     }
   }
+  if( h->lazySem )
+    OSS_SemRemove( h->osHdl, &h->lazySem );
 
   /* cleanup debug */
   DBGEXIT((&DBH));
@@ -2340,13 +2686,23 @@ static int32 Cleanup(
   /*------------------------------+
     |  free memory                  |
     +------------------------------*/
-  /* release memory for devices and groups */
-  for( i = 0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ) {
-    if( h->dev[i] ){
-      OSS_MemFree(h->osHdl, h->dev[i], h->devGotSize[i]);
-      h->dev[i] = NULL;
-    }
-  }
+  /* release table, unit info (if BrdExit not called), groups and slot tables */
+  if( h->chamHdl )
+    h->chamFuncTbl[h->tblType].Term( &h->chamHdl );
+  UnitArenaFree( h );
+  SlotTblFree( h );
+
+  /* release autoenum exclusion bitmap */
+  if( h->exclDevIds )
+    OSS_MemFree( h->osHdl, h->exclDevIds, h->exclDevIdsGotSize );
+
+  /* release slot priorities */
+  if( h->irqPrio )
+    OSS_MemFree( h->osHdl, h->irqPrio, h->irqPrioGotSize );
+
+  /* release published IRQ_REQ */
+  if( h->irqPendMem )
+    OSS_MemFree( h->osHdl, h->irqPendMem, h->irqPendGotSize );
 
   /* release memory for the board handle */
   OSS_MemFree( h->osHdl, (int8*)h, h->ownMemSize);
@@ -2466,7 +2822,7 @@ static int32 CfgInfoSlot( BBIS_HANDLE *h, va_list argptr )	/* nodoc */
   }
 
   /* illegal slot? */
-  if( h->devId[mSlot] == CHAMELEON_NO_DEV ) {
+  if( SlotUnused(h,mSlot) ) {
     /*
      * no debug print here because it will be called under Windows
      * with mSlot=0x00..0xff and 0x1000..0x10ff
@@ -2525,6 +2881,2237 @@ static int32 CfgInfoSlot( BBIS_HANDLE *h, va_list argptr )	/* nodoc */
   return ERR_SUCCESS;
 }
 
+/******************************* ExclDevIdsAdd ******************************
+ *
+ *  Description: Add excluded devIds of AUTOENUM to the exclusion bitmap
+ *
+ *               The bitmap over the full 16-bit devId space is allocated
+ *               with the first entry.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               excl       descriptor data
+ *               nbr        number of bytes in excl
+ *               width      1: one byte per devId/module code
+ *                          2: byte pairs, high byte first
+ *               isModCode  excl holds module codes (width 1 only)
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 ExclDevIdsAdd(
+			   BBIS_HANDLE *h,
+			   u_int8 *excl,
+			   u_int32 nbr,
+			   u_int32 width,
+			   int isModCode )	/* nodoc */
+{
+  u_int32 i;
+  u_int16 exclDevId;
+
+  if( nbr && !h->exclDevIds ) {
+    h->exclDevIds = (u_int32*)OSS_MemGet( h->osHdl, CHAM_DEVID_NUM / 8,
+					  &h->exclDevIdsGotSize );
+    if( !h->exclDevIds ) {
+      DBGWRT_ERR((DBH, "*** %s_Init: no ressources\n", BBNAME));
+      return ERR_OSS_MEM_ALLOC;
+    }
+    OSS_MemFill( h->osHdl, CHAM_DEVID_NUM / 8, (char*)h->exclDevIds, 0x00 );
+  }
+
+  for( i=0; i + width <= nbr; i += width ) {
+    if( width == 2 )
+      exclDevId = (u_int16)((excl[i] << 8) | excl[i+1]);
+    else
+      exclDevId = isModCode ? CHAM_ModCodeToDevId( excl[i] ) : excl[i];
+    BITMAP_SET( h->exclDevIds, exclDevId );
+    DBGWRT_2(( DBH, " excluded devId 0x%x\n", exclDevId ));
+  }
+
+  return ERR_SUCCESS;
+}
+
+/******************************* ParseSlotKeys ******************************
+ *
+ *  Description: Read the slot assignment of manual enumeration from the
+ *               DEVICE_ID(V2)_n and GROUP_n/... descriptor keys
+ *
+ *               The DESC library can only look up single keys, so every
+ *               key that is not present costs a complete descriptor search.
+ *               To keep the number of lookups small:
+ *               - groups are read first and their slots are not probed
+ *                 for DEVICE_ID(V2)_n keys again (a group always took
+ *                 precedence over a device key with the same slot number)
+ *               - member numbers are only probed for groups present in
+ *                 the descriptor, up to the first missing
+ *                 GROUP_n/DEVICE_IDV2_n key
+ *               - DEVICE_ID(V2)_n keys are always read for slots 0..15,
+ *                 higher slots up to the first missing key (use SLOT_MAP
+ *                 for sparse slot numbers above 15)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 ParseSlotKeys( BBIS_HANDLE *h )	/* nodoc */
+{
+  BBIS_CHAM_GRP *devGrp;
+  u_int32 i, g, n, value, *member, memberGotSize;
+  int32 status;
+
+  /* values of one group, group is allocated when member number known */
+  member = (u_int32*)OSS_MemGet( h->osHdl,
+				 CHAMELEON_BBIS_MAX_DEVS * sizeof(u_int32),
+				 &memberGotSize );
+  if( !member ) {
+    DBGWRT_ERR((DBH, "*** %s_Init: no ressources\n", BBNAME));
+    return ERR_OSS_MEM_ALLOC;
+  }
+
+  /* get GROUP_n/DEVICE_IDV2_n */
+  for( g=0; g < CHAMELEON_BBIS_MAX_GRPS; g++ ){
+
+    if( DESC_GetUInt32( h->descHdl, 0, &value,
+			"GROUP_%d/GROUP_ID", g) != ERR_SUCCESS )
+      continue;
+
+    /* members are numbered 0..n-1, stop at first missing key */
+    for( n=0; n < CHAMELEON_BBIS_MAX_DEVS; n++ ){
+
+      if( DESC_GetUInt32( h->descHdl, 0, &member[n],
+			  "GROUP_%d/DEVICE_IDV2_%d", g, n) != ERR_SUCCESS )
+	break;
+
+      DBGWRT_2(( DBH, " GROUP_%d/DEVICE_IDV2_%d = 0x%x\n",
+		 g, n, member[n] ));
+    }
+
+    /* a group needs at least one member */
+    if( n == 0 ) {
+      DBGWRT_ERR((DBH, "*** %s_Init: GROUP_%d has no DEVICE_IDV2_0\n",
+		  BBNAME, g));
+      OSS_MemFree( h->osHdl, member, memberGotSize );
+      return ERR_BBIS_DESC_PARAM;
+    }
+
+    /* group exists in descriptor? get memory for group */
+    devGrp = GrpAlloc( h, g, value, n );
+    if( !devGrp ) {
+      OSS_MemFree( h->osHdl, member, memberGotSize );
+      return ERR_OSS_MEM_ALLOC;
+    }
+
+    for( i=0; i < n; i++ ){
+      devGrp->devId[i] = (u_int16)((member[i] & 0xffffff00) >> 8);
+      devGrp->idx[i]   = (int16)member[i] & 0xff;
+    }
+    devGrp->devCount = n;
+
+    /* anounce group */
+    h->devId[g]  = CHAMELEON_BBIS_GROUP ;
+    h->devCount++;
+  }
+
+  OSS_MemFree( h->osHdl, member, memberGotSize );
+
+  /*
+   * get DEVICE_ID(V2)_n, group 0
+   * slots above the documented range are read until the first missing key
+   */
+  for( i=0; i < CHAMELEON_BBIS_MAX_DEVS; i++ ){
+
+    /* slot already used by group */
+    if( h->devId[i] == CHAMELEON_BBIS_GROUP )
+      continue;
+
+    if( (status = DESC_GetUInt32( h->descHdl, 0, &value,
+				  "DEVICE_IDV2_%d", i)) == ERR_SUCCESS )
+      {
+	h->devId[i] = (u_int16)((value & 0xffffff00) >> 8);
+	h->inst[i]  = (int16)(value & 0xff);
+	h->idx[i]   = 0;
+      } else if( (status = DESC_GetUInt32( h->descHdl, 0, &value,
+					   "DEVICE_ID_%d", i)) == ERR_SUCCESS )
+      {
+	u_int16 modId	= (u_int16)((value & 0xffffff00) >> 8);
+	h->inst[i]  = -1;
+	h->idx[i]   = value & 0xff;
+	h->devId[i] = CHAM_ModCodeToDevId( modId  );
+      }
+    if( status == ERR_SUCCESS)
+      {
+	h->devCount++;
+	DBGWRT_2(( DBH, " DEVICE_ID(V2)_%d = 0x%x\n", i, h->devId[i] ));
+      }
+    else if( i >= CHAM_SLOT_KEYS_NUM )
+      break;
+  }
+
+  return ERR_SUCCESS;
+}
+
+/******************************* ParseSlotMap *******************************
+ *
+ *  Description: Read the slot assignment of manual enumeration from the
+ *               SLOT_MAP descriptor key (see top of file)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *                          ERR_DESC_KEY_NOTFOUND if SLOT_MAP not present
+ *  Globals....: -
+ ****************************************************************************/
+static int32 ParseSlotMap( BBIS_HANDLE *h )	/* nodoc */
+{
+  BBIS_CHAM_GRP *devGrp;
+  u_int8 empty = 0, *map, *e;
+  u_int32 mapGotSize, mapLen, i, n, slot, group, member, memberNum;
+  u_int16 devId;
+  int32 status;
+
+  map = (u_int8*)OSS_MemGet( h->osHdl,
+			     CHAM_SLOTMAP_MAX * CHAM_SLOTMAP_ENTRY,
+			     &mapGotSize );
+  if( !map ) {
+    DBGWRT_ERR((DBH, "*** %s_Init: no ressources\n", BBNAME));
+    return ERR_OSS_MEM_ALLOC;
+  }
+
+  mapLen = CHAM_SLOTMAP_MAX * CHAM_SLOTMAP_ENTRY;
+  status = DESC_GetBinary( h->descHdl, &empty, 0, map, &mapLen, "SLOT_MAP");
+  if( status )
+    goto CLEANUP;
+
+  if( mapLen % CHAM_SLOTMAP_ENTRY ) {
+    DBGWRT_ERR((DBH, "*** %s_Init: SLOT_MAP length %d invalid\n",
+		BBNAME, mapLen));
+    status = ERR_BBIS_DESC_PARAM;
+    goto CLEANUP;
+  }
+
+  for( n=0; n < mapLen / CHAM_SLOTMAP_ENTRY; n++ ){
+    e      = &map[n * CHAM_SLOTMAP_ENTRY];
+    slot   = e[0];
+    devId  = (u_int16)((e[1] << 8) | e[2]);
+    group  = e[4];
+    member = e[5];
+
+    DBGWRT_2(( DBH, " SLOT_MAP slot %d devId 0x%x inst/idx %d grp %d "
+	       "member %d\n", slot, devId, e[3], group, member ));
+
+    if( group == 0 ) {
+      /* single device */
+      if( h->devId[slot] != CHAMELEON_NO_DEV || member != 0 ) {
+	DBGWRT_ERR((DBH, "*** %s_Init: SLOT_MAP entry %d invalid\n",
+		    BBNAME, n));
+	status = ERR_BBIS_DESC_PARAM;
+	goto CLEANUP;
+      }
+      h->devId[slot] = devId;
+      h->inst[slot]  = (int16)e[3];
+      h->idx[slot]   = 0;
+      h->devCount++;
+      continue;
+    }
+
+    /* group member, first member of a slot creates the group
+       sized to the highest member number of that slot */
+    if( h->devId[slot] == CHAMELEON_NO_DEV ) {
+      for( i=n, memberNum=0; i < mapLen / CHAM_SLOTMAP_ENTRY; i++ )
+	if( map[i * CHAM_SLOTMAP_ENTRY] == slot &&
+	    map[i * CHAM_SLOTMAP_ENTRY + 4] != 0 &&
+	    map[i * CHAM_SLOTMAP_ENTRY + 5] >= memberNum )
+	  memberNum = map[i * CHAM_SLOTMAP_ENTRY + 5] + 1;
+
+      if( !GrpAlloc( h, slot, group, memberNum ) ) {
+	status = ERR_OSS_MEM_ALLOC;
+	goto CLEANUP;
+      }
+
+      h->devId[slot] = CHAMELEON_BBIS_GROUP;
+      h->devCount++;
+    }
+
+    devGrp = (BBIS_CHAM_GRP*)h->dev[slot];
+    if( h->devId[slot] != CHAMELEON_BBIS_GROUP ||
+	devGrp->grpId != group ||
+	devGrp->devId[member] != CHAMELEON_NO_DEV ) {
+      DBGWRT_ERR((DBH, "*** %s_Init: SLOT_MAP entry %d invalid\n",
+		  BBNAME, n));
+      status = ERR_BBIS_DESC_PARAM;
+      goto CLEANUP;
+    }
+    devGrp->devId[member] = devId;
+    devGrp->idx[member]   = (int16)e[3];
+    devGrp->devCount++;
+  }
+
+  /* group members must be numbered without gaps */
+  for( slot=0; slot < h->slotNum; slot++ ){
+    if( h->devId[slot] != CHAMELEON_BBIS_GROUP )
+      continue;
+
+    devGrp = (BBIS_CHAM_GRP*)h->dev[slot];
+    if( devGrp->devCount != devGrp->memberNum ) {
+      DBGWRT_ERR((DBH, "*** %s_Init: SLOT_MAP group at slot %d has "
+		  "gaps in member numbers\n", BBNAME, slot));
+      status = ERR_BBIS_DESC_PARAM;
+      goto CLEANUP;
+    }
+  }
+
+ CLEANUP:
+  OSS_MemFree( h->osHdl, map, mapGotSize );
+  return status;
+}
+
+/******************************* SlotTblResize ******************************
+ *
+ *  Description: (Re)allocate the slot tables for num slots
+ *
+ *               All slot tables are carved from one memory block. Entries
+ *               of existing slots are kept, new entries are unused.
+ *               When shrinking, the dropped slots must be unused.
+ *               The dispatch order per GIRQ bit (see IrqBitAdd()) is
+ *               kept in the same block; it is reset with num=0.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               num        new number of slots
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SlotTblResize( BBIS_HANDLE *h, u_int32 num )	/* nodoc */
+{
+  void *tbl = NULL;
+  u_int32 tblGotSize = 0, keep, i;
+  void* *dev = NULL;
+  BBIS_CHAM_IRQ *irq = NULL;
+  u_int32 *idx = NULL, *devGotSize = NULL;
+  u_int32 (*prioMask)[2] = NULL;
+  u_int16 *devId = NULL, *devIdInit = NULL, *used = NULL;
+  u_int16 *bitNext = NULL, *bitSlot = NULL;
+  int16 *inst = NULL;
+
+  if( num ) {
+    tbl = OSS_MemGet( h->osHdl,
+		      num * ( sizeof(void*) + sizeof(BBIS_CHAM_IRQ) +
+			      2 * sizeof(u_int32) + 5 * sizeof(u_int16) ) +
+		      CHAM_IRQ_PRIO_NUM * sizeof(*prioMask) +
+		      CHAM_GIRQ_BITS * sizeof(u_int16),
+		      &tblGotSize );
+    if( !tbl ) {
+      DBGWRT_ERR((DBH, "*** %s: no ressources f. %d slots\n", BBNAME, num));
+      return ERR_OSS_MEM_ALLOC;
+    }
+
+    /* largest alignment first */
+    dev        = (void**)tbl;
+    prioMask   = (u_int32(*)[2])&dev[num];
+    irq        = (BBIS_CHAM_IRQ*)&prioMask[CHAM_IRQ_PRIO_NUM];
+    idx        = (u_int32*)&irq[num];
+    devGotSize = &idx[num];
+    devId      = (u_int16*)&devGotSize[num];
+    devIdInit  = &devId[num];
+    inst       = (int16*)&devIdInit[num];
+    used       = (u_int16*)&inst[num];
+    bitNext    = &used[num];
+    bitSlot    = &bitNext[num];
+
+    /* dispatch order: keep it, or no slot per GIRQ bit yet */
+    if( h->slotTbl ) {
+      OSS_MemCopy( h->osHdl, CHAM_IRQ_PRIO_NUM * sizeof(*prioMask),
+		   (char*)h->irqPrioMask, (char*)prioMask );
+      OSS_MemCopy( h->osHdl, CHAM_GIRQ_BITS * sizeof(u_int16),
+		   (char*)h->irqBitSlot, (char*)bitSlot );
+    } else {
+      OSS_MemFill( h->osHdl, CHAM_IRQ_PRIO_NUM * sizeof(*prioMask),
+		   (char*)prioMask, 0x00 );
+      OSS_MemFill( h->osHdl, CHAM_GIRQ_BITS * sizeof(u_int16),
+		   (char*)bitSlot, 0xff );
+    }
+
+    keep = num < h->slotNum ? num : h->slotNum;
+    for( i=0; i < num; i++ ){
+      if( i < keep ) {
+	dev[i]        = h->dev[i];
+	irq[i]        = h->irq[i];
+	idx[i]        = h->idx[i];
+	devGotSize[i] = h->devGotSize[i];
+	devId[i]      = h->devId[i];
+	devIdInit[i]  = h->devIdInit[i];
+	inst[i]       = h->inst[i];
+	bitNext[i]    = h->irqBitNext[i];
+      } else {
+	dev[i]        = NULL;
+	OSS_MemFill( h->osHdl, sizeof(*irq), (char*)&irq[i], 0x00 );
+	idx[i]        = 0;
+	devGotSize[i] = 0;
+	devId[i]      = CHAMELEON_NO_DEV;
+	devIdInit[i]  = CHAMELEON_NO_DEV;
+	inst[i]       = 0;
+	bitNext[i]    = CHAMELEON_NO_SLOT;
+      }
+    }
+  }
+
+  if( h->slotTbl )
+    OSS_MemFree( h->osHdl, h->slotTbl, h->slotTblGotSize );
+
+  h->slotTbl        = tbl;
+  h->slotTblGotSize = tblGotSize;
+  h->slotNum        = num;
+  h->dev            = dev;
+  h->irq            = irq;
+  h->idx            = idx;
+  h->devGotSize     = devGotSize;
+  h->devId          = devId;
+  h->devIdInit      = devIdInit;
+  h->inst           = inst;
+  h->used           = used;
+  h->irqBitNext     = bitNext;
+  h->irqPrioMask    = prioMask;
+  h->irqBitSlot     = bitSlot;
+
+  SlotUsedUpdate( h );
+  return ERR_SUCCESS;
+}
+
+/****************************** SlotUsedUpdate ******************************
+ *
+ *  Description: Rebuild the list of occupied slots
+ *
+ *               A slot is occupied when it holds a device or group, was
+ *               specified in *_Init or still references a group or unit
+ *               info (to be released).
+ *               Must be called whenever slots are added or cleared, so
+ *               that loops over the slots only visit occupied ones.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void SlotUsedUpdate( BBIS_HANDLE *h )	/* nodoc */
+{
+  u_int32 i;
+
+  h->usedNum = 0;
+  for( i=0; i < h->slotNum; i++ ){
+    if( h->devId[i] != CHAMELEON_NO_DEV ||
+	h->devIdInit[i] != CHAMELEON_NO_DEV || h->dev[i] )
+      h->used[h->usedNum++] = (u_int16)i;
+  }
+}
+
+/******************************* SlotTblFree ********************************
+ *
+ *  Description: Release all groups and the slot tables
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void SlotTblFree( BBIS_HANDLE *h )	/* nodoc */
+{
+  u_int32 s, i;
+
+  for( s=0; s < h->usedNum; s++ ){
+    i = h->used[s];
+    if( h->dev[i] && h->devGotSize[i] )
+      OSS_MemFree( h->osHdl, h->dev[i], h->devGotSize[i] );
+  }
+
+  /* can't fail with num=0 */
+  SlotTblResize( h, 0 );
+}
+
+/********************************* GrpAlloc *********************************
+ *
+ *  Description: Allocate a group with memberNum unused members for slot
+ *
+ *               The member tables follow the BBIS_CHAM_GRP struct in the
+ *               same memory block.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot of group
+ *               grpId      group ID from table
+ *               memberNum  number of group members, >0 (the interrupt
+ *                          and CfgInfo paths use member 0)
+ *  Output.....: returns:   group or NULL if no memory
+ *  Globals....: -
+ ****************************************************************************/
+static BBIS_CHAM_GRP *GrpAlloc(
+			       BBIS_HANDLE *h,
+			       u_int32 slot,
+			       u_int32 grpId,
+			       u_int32 memberNum )	/* nodoc */
+{
+  BBIS_CHAM_GRP *grp;
+  u_int32 size, i;
+
+  size = sizeof(BBIS_CHAM_GRP) +
+    memberNum * ( sizeof(void*) + 2 * sizeof(u_int16) );
+
+  grp = (BBIS_CHAM_GRP*)OSS_MemGet( h->osHdl, size, &h->devGotSize[slot] );
+  if( !grp ) {
+    DBGWRT_ERR((DBH, "*** %s: no ressources f. group %d\n", BBNAME, grpId));
+    return NULL;
+  }
+  OSS_MemFill( h->osHdl, size, (char*)grp, 0x00 );
+
+  grp->dev       = (void**)&grp[1];
+  grp->devId     = (u_int16*)&grp->dev[memberNum];
+  grp->idx       = &grp->devId[memberNum];
+  grp->grpId     = grpId;
+  grp->memberNum = memberNum;
+  for( i=0; i < memberNum; i++ )
+    grp->devId[i] = CHAMELEON_NO_DEV;
+
+  h->dev[slot] = grp;
+  return grp;
+}
+
+/******************************* LazyPrepare ********************************
+ *
+ *  Description: Prepare lazy enumeration in *_BrdInit
+ *
+ *               Gets the unit arena for all modules specified, the units
+ *               are filled by SlotResolve() on first access of a slot.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 LazyPrepare( BBIS_HANDLE *h )	/* nodoc */
+{
+  u_int32 s, i, num = 0;
+
+  for( s=0; s < h->usedNum; s++ ){
+    i = h->used[s];
+    if( h->devId[i] == CHAMELEON_BBIS_GROUP )
+      num += ((BBIS_CHAM_GRP*)h->dev[i])->devCount;
+    else if( h->devId[i] != CHAMELEON_NO_DEV )
+      num++;
+  }
+
+  DBGWRT_2((DBH," lazy enumeration of %d units\n", num));
+
+  h->unitArenaUsed = 0;
+  h->unitArena = (CHAMELEONV2_UNIT*)OSS_MemGet( h->osHdl,
+						num * sizeof(CHAMELEONV2_UNIT),
+						&h->unitArenaGotSize );
+  if( !h->unitArena ) {
+    DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources f. %d chamUnits\n",
+		BBNAME, num));
+    return ERR_OSS_MEM_ALLOC;
+  }
+
+  return ERR_SUCCESS;
+}
+
+/******************************* SlotResolve ********************************
+ *
+ *  Description: Lazy enumeration: look up the modules of a slot
+ *
+ *               Nothing is done if the slot was already looked up. If a
+ *               module can't be found, the slot is flagged unusable.
+ *
+ *               CfgInfo, GetMAddr and IrqEnable of different devices may
+ *               run concurrently (task context only). The lookup reads
+ *               the chameleon table over the bus, so it runs under
+ *               h->lazySem, which also protects the free part of the unit
+ *               arena. Only the found units, the arena use and the
+ *               interrupt routing are published under h->slHdl. The ISR of
+ *               the slot is only installed after BBIS_CFGINFO_IRQ has
+ *               looked it up.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       used slot
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SlotResolve( BBIS_HANDLE *h, u_int32 slot )	/* nodoc */
+{
+  CHAMELEONV2_FIND chamFind;
+  BBIS_CHAM_GRP *lGrp = NULL;
+  CHAMELEONV2_UNIT *unitP;
+  void **unitPP;
+  int32 n, num, idx, chErr, done, error;
+
+  if( h->devId[slot] == CHAMELEON_BBIS_GROUP ) {
+    lGrp   = (BBIS_CHAM_GRP*)h->dev[slot];
+    unitPP = lGrp->dev;
+    num    = lGrp->devCount;
+    chamFind.group    = (int16)lGrp->grpId;
+    chamFind.instance = -1; /* not used, instead use index of dev */
+  } else {
+    unitPP = &h->dev[slot];
+    num    = 1;
+    chamFind.group    = 0;
+    chamFind.instance = h->inst[slot];
+  }
+
+  /* already looked up? */
+  if( (error = SlotResolved( h, slot, unitPP, &done )) || done )
+    return error;
+
+  if( (error = OSS_SemWait( h->osHdl, h->lazySem, OSS_SEM_WAITFOREVER )) )
+    return error;
+
+  /* looked up while waiting? */
+  if( (error = SlotResolved( h, slot, unitPP, &done )) || done )
+    goto SIGNAL;
+
+  chamFind.variant  = -1;
+  chamFind.busId    = -1;
+  chamFind.bootAddr = -1;
+
+  unitP = &h->unitArena[h->unitArenaUsed];
+  for( n=0; n < num; n++ ){
+    chamFind.devId = lGrp ? lGrp->devId[n] : h->devId[slot];
+    idx            = lGrp ? lGrp->idx[n]   : (int32)h->idx[slot];
+
+    DBGWRT_2((DBH," slot %d: looking for devId=0x%x grp %d index %d\n",
+	      slot, chamFind.devId, chamFind.group, idx ));
+
+    if( (chErr = h->chamFuncTbl[h->tblType].InstanceFind(
+							 h->chamHdl, idx, chamFind, &unitP[n],
+							 NULL, NULL))
+	!= CHAMELEONV2_UNIT_FOUND )
+      {
+	DBGWRT_ERR((DBH, "*** %s: can't find devId=0x%x group=%d "
+		    "index %d (chErr = 0x%x)\n",
+		    BBNAME, chamFind.devId, chamFind.group, idx, chErr ));
+	break;
+      }
+  }
+
+  if( (error = OSS_SpinLockAcquire( h->osHdl, h->slHdl )) )
+    goto SIGNAL;
+
+  if( n < num ) {
+    h->devId[slot] = CHAMELEON_NO_DEV;	/* flag slot unusuable */
+    error = ERR_BBIS_ILL_SLOT;
+  }
+  else {
+    /* all modules found, take units from arena */
+    for( n=0; n < num; n++ )
+      unitPP[n] = &unitP[n];
+    h->unitArenaUsed += num;
+
+    IrqRouteBuild( h, slot );
+  }
+
+  OSS_SpinLockRelease( h->osHdl, h->slHdl );
+
+ SIGNAL:
+  OSS_SemSignal( h->osHdl, h->lazySem );
+  return error;
+}
+
+/******************************* SlotResolved *******************************
+ *
+ *  Description: Lazy enumeration: check if slot was already looked up
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       used slot
+ *               unitPP     unit pointers of slot
+ *  Output.....: returns:   error code
+ *                          ERR_BBIS_ILL_SLOT if lookup failed before
+ *               *doneP     TRUE if looked up (or failed)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SlotResolved(
+			  BBIS_HANDLE *h,
+			  u_int32 slot,
+			  void **unitPP,
+			  int32 *doneP )	/* nodoc */
+{
+  int32 error;
+
+  *doneP = FALSE;
+  if( (error = OSS_SpinLockAcquire( h->osHdl, h->slHdl )) )
+    return error;
+
+  if( h->devId[slot] == CHAMELEON_NO_DEV ) {
+    *doneP = TRUE;
+    error  = ERR_BBIS_ILL_SLOT;
+  }
+  else if( unitPP[0] )
+    *doneP = TRUE;
+
+  OSS_SpinLockRelease( h->osHdl, h->slHdl );
+  return error;
+}
+
+/******************************** SlotUnused ********************************
+ *
+ *  Description: Check if slot can't be used
+ *
+ *               With lazy enumeration, the modules of the slot are looked
+ *               up on first call.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot number
+ *  Output.....: returns:   TRUE if slot not used or module not found
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SlotUnused( BBIS_HANDLE *h, u_int32 slot )	/* nodoc */
+{
+  if( SLOT_FREE(h,slot) )
+    return TRUE;
+
+  if( h->chamHdl && SlotResolve( h, slot ) )
+    return TRUE;
+
+  return FALSE;
+}
+
+/****************************** IrqRouteBuild *******************************
+ *
+ *  Description: Precompute interrupt routing of slot
+ *
+ *               Fills h->irq[slot] from the unit's interrupt in the
+ *               chameleon table (for groups, the first member), so that
+ *               the interrupt paths need no lookup of unit info.
+ *               A zero entry means no interrupt or slot not looked up.
+ *
+ *               The GIRQ bit is added to the mask of the slot's IRQ_PRIO
+ *               for IrqOrder(), see IrqBitAdd().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot number
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqRouteBuild( BBIS_HANDLE *h, u_int32 slot )	/* nodoc */
+{
+  BBIS_CHAM_IRQ *r = &h->irq[slot];
+  CHAMELEONV2_UNIT *unit = NULL;
+  u_int32 chamTblInt;
+
+  /* routing built before */
+  if( r->mask )
+    IrqBitDel( h, slot );
+
+  OSS_MemFill( h->osHdl, sizeof(*r), (char*)r, 0x00 );
+
+  if( SLOT_FREE(h,slot) || !h->dev[slot] )
+    return;
+
+  if( h->devId[slot] == CHAMELEON_BBIS_GROUP )
+    unit = (CHAMELEONV2_UNIT*)((BBIS_CHAM_GRP*)h->dev[slot])->dev[0];
+  else
+    unit = (CHAMELEONV2_UNIT*)h->dev[slot];
+
+  if( !unit )
+    return;
+
+  chamTblInt = unit->interrupt;
+
+  /* using irq level from chameleon table (may be overwritten below!) */
+  r->level = chamTblInt;
+  r->mode  = BBIS_IRQ_SHARED;
+
+  /* module does not have interrupt possibilities? */
+  if( chamTblInt == 0x3F ) {
+#ifdef CHAM_ISA
+    r->mode = BBIS_IRQ_NONE;
+#endif
+  }
+  /* GIRQ enable/request bit, registers have 64 bit */
+  else {
+    r->offs = (u_int8)((chamTblInt >> 5) * 4);
+    r->mask = 0x00000001 << (chamTblInt & 31);
+  }
+
+#ifdef CHAM_ISA
+  /* IRQ_NUMBER specified in descriptor? */
+  if( h->isaIrqNbr != TABLE_IRQ ){
+    /* interrupt connected? */
+    if( h->isaIrqNbr )
+      r->level = h->isaIrqNbr;
+    /* no interrupt */
+    else
+      r->mode = BBIS_IRQ_NONE;
+  }
+#endif
+
+#ifdef CHAMELEON_USE_PCITABLE
+  /* irq of FPGA from PCI config space, read once by *_BrdInit */
+  r->level  = h->pciIrqLevel;
+  r->vector = h->pciIrqVector;
+
+  /* no interrupt available ? */
+  if( r->level == 0xff )
+    r->mode = BBIS_IRQ_NONE;
+#else
+  OSS_IrqLevelToVector( h->osHdl, BUSTYPE,
+			r->level, (int32 *)&r->vector );
+#endif
+
+  /* polled slot: no interrupt for MDIS, keep GIRQ bit for polling */
+  if( BITMAP_TST( h->irqPoll, slot ) ) {
+    r->mode   = BBIS_IRQ_NONE;
+    r->flags |= CHAM_IRQ_POLL;
+  }
+  else if( BITMAP_TST( h->irqMod, slot ) )
+    r->flags |= CHAM_IRQ_MOD;
+
+  /* dispatch order */
+  if( r->mask )
+    IrqBitAdd( h, slot );
+}
+
+/********************************* IrqBitAdd ********************************
+ *
+ *  Description: Add slot to the dispatch order of its GIRQ bit
+ *
+ *               Units may share a GIRQ bit. The slots of one bit are
+ *               chained in slot order from irqBitSlot[bit] through
+ *               irqBitNext[], and the bit is set in the irqPrioMask of
+ *               each IRQ_PRIO level of these slots.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot number, h->irq[slot].mask set
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqBitAdd( BBIS_HANDLE *h, u_int32 slot )	/* nodoc */
+{
+  BBIS_CHAM_IRQ *r = &h->irq[slot];
+  u_int16 *sp = &h->irqBitSlot[(r->offs / 4) * 32 + CTZ32(r->mask)];
+
+  while( *sp < slot )
+    sp = &h->irqBitNext[*sp];
+
+  h->irqBitNext[slot] = *sp;
+  *sp = (u_int16)slot;
+
+  h->irqPrioMask[SLOT_PRIO(h,slot)][r->offs / 4] |= r->mask;
+}
+
+/********************************* IrqBitDel ********************************
+ *
+ *  Description: Remove slot from the dispatch order of its GIRQ bit
+ *
+ *               The bit stays in the irqPrioMask of the slot's IRQ_PRIO
+ *               level while another slot of that level shares it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot number, h->irq[slot].mask set
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqBitDel( BBIS_HANDLE *h, u_int32 slot )	/* nodoc */
+{
+  BBIS_CHAM_IRQ *r = &h->irq[slot];
+  u_int32 bit = (r->offs / 4) * 32 + CTZ32(r->mask);
+  u_int8 prio = SLOT_PRIO(h,slot);
+  u_int16 *sp, s;
+
+  for( sp = &h->irqBitSlot[bit]; *sp != CHAMELEON_NO_SLOT;
+       sp = &h->irqBitNext[*sp] ) {
+    if( *sp == slot ) {
+      *sp = h->irqBitNext[slot];
+      break;
+    }
+  }
+
+  for( s = h->irqBitSlot[bit]; s != CHAMELEON_NO_SLOT; s = h->irqBitNext[s] )
+    if( SLOT_PRIO(h,s) == prio )
+      return;
+
+  h->irqPrioMask[prio][r->offs / 4] &= ~r->mask;
+}
+
+/******************************** IrqPrioAbove ******************************
+ *
+ *  Description: Check for a pending interrupt of a higher IRQ_PRIO
+ *
+ *               The GIRQ bits of the levels above the slot's IRQ_PRIO
+ *               are masked with IRQ_EN (polled and held off bits are not
+ *               set there) and checked in the request register. With one
+ *               half read, the other half of IRQ_REQ is read only when it
+ *               holds such bits.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               slot       slot number, h->irq[slot].mask set
+ *               req        IRQ_REQ, half of slot valid
+ *               num        number of halves valid (1 or 2)
+ *  Output.....: returns:   TRUE when a higher level is pending
+ *               req        other half read if needed
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IrqPrioAbove(
+			  BBIS_HANDLE *h,
+			  u_int32 slot,
+			  u_int32 req[2],
+			  int num )	/* nodoc */
+{
+  BBIS_CHAM_IRQ *r = &h->irq[slot];
+  u_int32 above[2] = { 0, 0 };
+  int half = r->offs / 4;
+  int prio;
+
+  for( prio = SLOT_PRIO(h,slot) - 1; prio >= 0; prio-- ) {
+    above[0] |= h->irqPrioMask[prio][0];
+    above[1] |= h->irqPrioMask[prio][1];
+  }
+  above[0] &= h->girq->en[0];
+  above[1] &= h->girq->en[1];
+
+  if( above[half] & req[half] )
+    return TRUE;
+
+  if( !above[half ^ 1] )
+    return FALSE;
+
+  if( num == 1 )
+    GirqRegRead( h, BBCHAM_GIRQ_IRQ_REQ, half ^ 1, 1, req );
+  return (above[half ^ 1] & req[half ^ 1]) ? TRUE : FALSE;
+}
+
+/******************************** GirqAttach ********************************
+ *
+ *  Description: Attach handle to the shared state of a GIRQ unit
+ *
+ *               All handles of one FPGA share the mapping of the GIRQ
+ *               unit, the spinlock, the IRQ_EN shadow and the INUSE
+ *               statistics. The state is looked up in G_girqList by
+ *               physical address. The first handle maps the unit and
+ *               reads IRQ_EN and the API version.
+ *
+ *               G_girqList and the reference counts are locked by
+ *               GIRQ_LIST_LOCK().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               physAddr   GIRQ unit physical address
+ *               type       OSS_ADDRSPACE_MEM | OSS_ADDRSPACE_IO
+ *               busId      bus number of GIRQ unit
+ *  Output.....: returns:   error code
+ *               h->girq    shared GIRQ state
+ *  Globals....: G_girqList
+ ****************************************************************************/
+static int32 GirqAttach(
+			BBIS_HANDLE *h,
+			char *physAddr,
+			u_int32 type,
+			u_int32 busId )	/* nodoc */
+{
+  BBIS_CHAM_GIRQ *g;
+  u_int32 gotSize;
+  int32 error = ERR_SUCCESS;
+
+  GIRQ_LIST_LOCK( h );
+
+  /* already used by other handle? */
+  for( g = G_girqList; g; g = g->next )
+    if( g->physAddr == physAddr && g->type == type )
+      break;
+
+  if( g ) {
+    g->refCnt++;
+    h->girq = g;
+    DBGWRT_1((DBH, "%s_BrdInit: girq at phys %08p shared, %d users\n",
+	      BBNAME, g->physAddr, g->refCnt ));
+    goto UNLOCK;
+  }
+
+  if( !(g = (BBIS_CHAM_GIRQ*)OSS_MemGet( h->osHdl, sizeof(*g), &gotSize )) ) {
+    DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources\n", BBNAME));
+    error = ERR_OSS_MEM_ALLOC;
+    goto UNLOCK;
+  }
+  OSS_MemFill( h->osHdl, sizeof(*g), (char*)g, 0x00 );
+  g->gotSize  = gotSize;
+  g->physAddr = physAddr;
+  g->type     = type;
+
+  /* map address - address space MEM and bus type PCI
+     must be adapted if it will be used for i.e. M199 */
+  error = OSS_MapPhysToVirtAddr( h->osHdl, g->physAddr,
+				 BBCHAM_GIRQ_SPACE_SIZE,
+				 g->type, /* 0=mem, 1=io */
+				 BUSTYPE,
+				 busId /* pci bus number */,
+				 (void**) &g->virtAddr );
+  if( error ) {
+    DBGWRT_ERR((DBH," *** %s_BrdInit: OSS_MapPhysToVirtAddr() girqPhysAddr %08p failed\n",
+		BBNAME, g->physAddr ));
+    goto ABORT_FREE;
+  }
+
+#ifdef VXWORKS
+  g->slHdl = &g->vxSpinlock;
+#endif
+
+  if( (error = OSS_SpinLockCreate( h->osHdl, &g->slHdl )) ) {
+    DBGWRT_ERR((DBH, "*** BB - %s_BrdInit: OSS_SpinLockCreate() failed! "
+		"Error 0x%0x\n", BBNAME, error ));
+    goto ABORT_UNMAP;
+  }
+
+  h->girq = g;
+  GirqRegRead( h, BBCHAM_GIRQ_IRQ_EN, 0, 2, g->en );
+  _MREAD_D32(g->apiVersion, g->virtAddr, BBCHAM_GIRQ_API_VER );
+#ifdef	_BIG_ENDIAN_
+  g->apiVersion = OSS_SWAP32( g->apiVersion );
+#endif
+  /* get api version from topmost byte */
+  g->apiVersion = g->apiVersion >> BBCHAM_GIRQ_API_VER_OFF;
+
+  /* current setting counts as enabled by drivers */
+  g->want[0] = g->en[0];
+  g->want[1] = g->en[1];
+
+  DBGWRT_1((DBH, "%s_BrdInit: girq found at phys %08p virt %08p - "
+	    "IRQEN current setting %08x %08x, api version 0x%08x\n",
+	    BBNAME, g->physAddr, g->virtAddr, g->en[0], g->en[1],
+	    g->apiVersion ));
+
+  g->refCnt  = 1;
+  g->next    = G_girqList;
+  G_girqList = g;
+  goto UNLOCK;
+
+ ABORT_UNMAP:
+  OSS_UnMapVirtAddr( h->osHdl, (void**)&g->virtAddr,
+		     BBCHAM_GIRQ_SPACE_SIZE, g->type );
+ ABORT_FREE:
+  OSS_MemFree( h->osHdl, (int8*)g, g->gotSize );
+ UNLOCK:
+  GIRQ_LIST_UNLOCK();
+  return error;
+}
+
+/******************************** GirqDetach ********************************
+ *
+ *  Description: Detach handle from the shared state of its GIRQ unit
+ *
+ *               The GIRQ bits of the handle's slots are removed from the
+ *               enables wanted by drivers and from the deferred enables,
+ *               so no other handle writes them again. Bits held off by
+ *               the handle's interrupt moderation are no longer held.
+ *               The last handle unmaps the unit and frees the state,
+ *               under GIRQ_LIST_LOCK() like GirqAttach().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *               h->girq    NULL
+ *  Globals....: G_girqList
+ ****************************************************************************/
+static int32 GirqDetach( BBIS_HANDLE *h )	/* nodoc */
+{
+  BBIS_CHAM_GIRQ *g = h->girq, **gp;
+  BBIS_CHAM_IRQ *r;
+  u_int32 ownMask[2] = { 0, 0 };
+  u_int32 n;
+  int32 error;
+  int half;
+
+  h->girq = NULL;
+
+  /* GIRQ bits of own slots */
+  for( n=0; n < h->usedNum; n++ ) {
+    r = &h->irq[h->used[n]];
+    ownMask[r->offs / 4] |= r->mask;
+  }
+
+  if( (error = OSS_SpinLockAcquire( h->osHdl, g->slHdl )) == ERR_SUCCESS ) {
+    for( half=0; half < 2; half++ ) {
+      g->want[half]    &= ~ownMask[half];
+      g->pend[half]    &= ~ownMask[half];
+      g->held[half]    &= ~h->girqHeld[half];
+      h->girqHeld[half] = 0;
+    }
+    OSS_SpinLockRelease( h->osHdl, g->slHdl );
+  }
+
+  GIRQ_LIST_LOCK( h );
+
+  if( --g->refCnt == 0 ) {
+    /* last user */
+    for( gp = &G_girqList; *gp != g; gp = &(*gp)->next )
+      ;
+    *gp = g->next;
+
+    if( (error = OSS_UnMapVirtAddr( h->osHdl, (void**)&g->virtAddr,
+				    BBCHAM_GIRQ_SPACE_SIZE, g->type )) ) {
+      DBGWRT_ERR((DBH,"*** %s_BrdExit: OSS_UnMapVirtAddr() girqVirtAddr %08p failed\n",
+		  BBNAME, g->virtAddr ) );
+    }
+
+    OSS_SpinLockRemove( h->osHdl, &g->slHdl );
+    OSS_MemFree( h->osHdl, (int8*)g, g->gotSize );
+  }
+
+  GIRQ_LIST_UNLOCK();
+  return error;
+}
+
+/******************************** GirqRegRead *******************************
+ *
+ *  Description: Read 32-bit halves of a 64-bit GIRQ register
+ *
+ *               With CHAMELEON_GIRQ_D64, both halves of a memory mapped
+ *               GIRQ are read with one 64-bit access. Otherwise each half
+ *               is read on its own.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               reg        BBCHAM_GIRQ_IRQ_REQ | BBCHAM_GIRQ_IRQ_EN
+ *               half       first half: 0=lower, 1=upper
+ *               num        number of halves (1 or 2)
+ *  Output.....: val        val[half..half+num-1] in CPU byte order
+ *  Globals....: -
+ ****************************************************************************/
+static void GirqRegRead(
+			BBIS_HANDLE *h,
+			u_int32 reg,
+			int half,
+			int num,
+			u_int32 val[2] )	/* nodoc */
+{
+  BBIS_CHAM_GIRQ *g = h->girq;
+
+#ifdef CHAMELEON_GIRQ_D64
+  if( num == 2 && GIRQ_ACC_HALVES(g) == 2 ) {
+    u_int64 val64 = MREAD_D64(g->virtAddr, reg);
+
+#ifdef _BIG_ENDIAN_
+    val[0] = OSS_SWAP32( (u_int32)(val64 >> 32) );
+    val[1] = OSS_SWAP32( (u_int32)val64 );
+#else
+    val[0] = (u_int32)val64;
+    val[1] = (u_int32)(val64 >> 32);
+#endif
+    return;
+  }
+#endif
+
+  for( ; num > 0; half++, num-- ) {
+    _MREAD_D32(val[half], g->virtAddr, reg + half * 4);
+#ifdef _BIG_ENDIAN_
+    val[half] = OSS_SWAP32( val[half] );
+#endif
+  }
+}
+
+/******************************* GirqRegWrite *******************************
+ *
+ *  Description: Write 32-bit halves of a 64-bit GIRQ register
+ *
+ *               See GirqRegRead().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               reg        BBCHAM_GIRQ_IRQ_EN
+ *               half       first half: 0=lower, 1=upper
+ *               num        number of halves (1 or 2)
+ *               val        val[half..half+num-1] in CPU byte order
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void GirqRegWrite(
+			 BBIS_HANDLE *h,
+			 u_int32 reg,
+			 int half,
+			 int num,
+			 u_int32 val[2] )	/* nodoc */
+{
+  BBIS_CHAM_GIRQ *g = h->girq;
+  u_int32 val32;
+
+#ifdef CHAMELEON_GIRQ_D64
+  if( num == 2 && GIRQ_ACC_HALVES(g) == 2 ) {
+    u_int64 val64;
+
+#ifdef _BIG_ENDIAN_
+    val64 = ((u_int64)OSS_SWAP32( val[0] ) << 32) | OSS_SWAP32( val[1] );
+#else
+    val64 = ((u_int64)val[1] << 32) | val[0];
+#endif
+    MWRITE_D64(g->virtAddr, reg, val64);
+    return;
+  }
+#endif
+
+  for( ; num > 0; half++, num-- ) {
+#ifdef _BIG_ENDIAN_
+    val32 = OSS_SWAP32( val[half] );
+#else
+    val32 = val[half];
+#endif
+    _MWRITE_D32(g->virtAddr, reg + half * 4, val32);
+  }
+}
+
+/******************************** GirqUpdate ********************************
+ *
+ *  Description: Set and clear bits in GIRQ IRQ_EN register
+ *
+ *               All changes are done with one spinlock acquisition and
+ *               one write per changed 32-bit half. Bits in both masks
+ *               are set.
+ *
+ *               The spinlock and the shadow are shared by all handles of
+ *               the FPGA. Without GIRQ API version, nobody else writes
+ *               IRQ_EN and the shadow en[] is written. Otherwise the
+ *               register is updated under the GIRQ INUSE lock and verified.
+ *
+ *               Bits held off by interrupt moderation (IrqModerate())
+ *               are only remembered in want[] and set again with
+ *               GIRQ_UPD_RELEASE of the handle that held them off.
+ *
+ *               With IRQ_EN_DEFER, a GIRQ_UPD_ENABLE that only sets bits
+ *               is remembered in pend[] and the flush alarm is started.
+ *               Pending bits are written with the next update of any
+ *               handle or GIRQ_UPD_FLUSH. Disabling is never deferred,
+ *               no interrupt must occur after a driver disabled it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               setMask    bits to set (lower/upper 32 bit)
+ *               clrMask    bits to clear (lower/upper 32 bit)
+ *               mode       GIRQ_UPD_ENABLE: set/clear as requested
+ *                          GIRQ_UPD_RELEASE: set held off bits still
+ *                                            enabled (setMask is output),
+ *                                            sets IrqModAlarm() again on
+ *                                            INUSE timeout
+ *                          GIRQ_UPD_FLUSH:  write deferred enables
+ *  Output.....: returns:   error code, ERR_OSS_TIMEOUT if the GIRQ INUSE
+ *                          lock could not be taken (IRQ_EN unchanged)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 GirqUpdate(
+			BBIS_HANDLE *h,
+			u_int32 setMask[2],
+			u_int32 clrMask[2],
+			int32 mode )	/* nodoc */
+{
+  DBGCMD(	static const char functionName[] = "_GirqUpdate:"; )
+  int32	error, error2;
+  u_int32 irqen[2];
+  u_int32 irqen_readback[2];
+  u_int32 girqInUse;
+  u_int32 pend[2];
+  u_int32 realMsec;
+  int half, num, k, i, defer = 0, rearm = 0;
+  BBIS_CHAM_GIRQ *g = h->girq;
+
+  /* lock critical section by spinlock to be multiprocessor safe */
+  error = OSS_SpinLockAcquire( h->osHdl, g->slHdl );
+  if (error)
+    {
+      DBGWRT_ERR((DBH, "*** BB - %s%s: OSS_SpinLockAcquire() failed!"
+		  "Error 0x%0x\n",
+		  BBNAME, functionName, error ));
+      return error;
+    }
+
+  /* interrupt moderation bookkeeping */
+  if( mode == GIRQ_UPD_RELEASE )
+    h->irqModArmed = 0;
+
+  for( half=0; half < 2; half++ ) {
+    switch( mode ) {
+    case GIRQ_UPD_RELEASE:
+      setMask[half] = h->girqHeld[half] & g->want[half];
+      g->held[half]    &= ~h->girqHeld[half];
+      h->girqHeld[half] = 0;
+      break;
+    case GIRQ_UPD_FLUSH:
+      break;
+    default:
+      g->want[half] = (g->want[half] & ~clrMask[half]) | setMask[half];
+      setMask[half] &= ~g->held[half];
+    }
+  }
+
+  /* deferred enable: remember bits, write later */
+  if( mode == GIRQ_UPD_ENABLE && h->irqEnDefer &&
+      !(clrMask[0] | clrMask[1]) ) {
+    g->pend[0] |= setMask[0];
+    g->pend[1] |= setMask[1];
+    /* no alarm when nothing is to be set (empty mask, bits held off) */
+    defer = (setMask[0] | setMask[1]) != 0;
+    goto UNLOCK;
+  }
+
+  /* write deferred enables still wanted along with this update */
+  for( half=0; half < 2; half++ ) {
+    pend[half]     = g->pend[half] & g->want[half] & ~g->held[half];
+    setMask[half] |= pend[half];
+    g->pend[half]  = 0;
+  }
+
+  /* nothing to write */
+  if( !(setMask[0] | setMask[1] | clrMask[0] | clrMask[1]) )
+    goto UNLOCK;
+
+  /* 32-bit halves per access: CHAMELEON_GIRQ_D64 accesses both at once */
+  num = GIRQ_ACC_HALVES(g);
+
+  /* no concurrent GIRQ writer: shadow is authoritative, one write */
+  if( !g->apiVersion ) {
+    for( half=0; half < 2; half += num ) {
+      if( num == 1 && !(setMask[half] | clrMask[half]) )
+	continue;
+
+      for( k=half; k < half + num; k++ )
+	g->en[k] = (g->en[k] & ~clrMask[k]) | setMask[k];
+
+      GirqRegWrite( h, BBCHAM_GIRQ_IRQ_EN, half, num, g->en );
+    }
+  }
+  else {
+    /* GIRQ INUSE_STS bit available */
+    if( (error = GirqInUseTake( h )) ) {
+      for( half=0; half < 2; half++ ) {
+	/* keep bits held off, release is retried */
+	if( mode == GIRQ_UPD_RELEASE ) {
+	  h->girqHeld[half] |= setMask[half] & ~pend[half];
+	  g->held[half]     |= setMask[half] & ~pend[half];
+	}
+	/* keep enables deferred, flush is retried */
+	g->pend[half] |= pend[half];
+      }
+      defer = h->irqEnDefer && (pend[0] | pend[1]);
+      if( mode == GIRQ_UPD_RELEASE && !h->irqModArmed )
+	rearm = h->irqModArmed = 1;
+      goto UNLOCK;
+    }
+
+    for( half=0; half < 2; half += num ) {
+      if( num == 1 && !(setMask[half] | clrMask[half]) )
+	continue;
+
+      /* Verify and re-write if BBCHAM_GIRQ_IRQ_EN has changed in the meantime
+       * This problem occured with async use of vxbmengirq, which can overwrite the BBCHAM_GIRQ_IRQ_EN register
+       */
+      for(i=0; i<10; i++)
+	{
+	  GirqRegRead( h, BBCHAM_GIRQ_IRQ_EN, half, num, irqen );
+
+	  for( k=half; k < half + num; k++ )
+	    irqen[k] = (irqen[k] & ~clrMask[k]) | setMask[k];
+
+	  GirqRegWrite( h, BBCHAM_GIRQ_IRQ_EN, half, num, irqen );
+
+	  /* wait and verify */
+	  OSS_MikroDelay(h->osHdl, 100 );
+	  GirqRegRead( h, BBCHAM_GIRQ_IRQ_EN, half, num, irqen_readback );
+
+	  if( irqen_readback[half] == irqen[half] &&
+	      irqen_readback[half + num - 1] == irqen[half + num - 1] )
+	    break;
+
+	  DBGWRT_ERR((DBH, "*** BB - %s%s: BBCHAM_GIRQ_IRQ_EN has been overwritten, retry #%d\n", BBNAME,functionName, i ));
+	}
+      if( i >= 10 )
+	{
+	  DBGWRT_ERR((DBH, "*** BB - %s%s: unable to set BBCHAM_GIRQ_IRQ_EN correctly!\n", BBNAME,functionName));
+	}
+
+      /* keep shadow in sync with what other writers left */
+      for( k=half; k < half + num; k++ )
+	g->en[k] = irqen[k];
+    }
+
+    /* set current bit for release */
+    girqInUse = BBCHAM_GIRQ_IN_USE_BIT;
+#ifdef _BIG_ENDIAN_
+    girqInUse = OSS_SWAP32( girqInUse );
+#endif
+
+    /* release INUSE bit */
+    _MWRITE_D32(g->virtAddr, BBCHAM_GIRQ_IN_USE, girqInUse);
+    DBGWRT_1((DBH, "BB - %s%s: GIRQ INUSE bit released.\n",
+	      BBNAME, functionName ));
+  }
+
+  /* release spinlock */
+ UNLOCK:
+  /* deferred enables: written by alarm at the latest, set it once */
+  if( defer && !h->irqEnArmed )
+    h->irqEnArmed = 1;
+  else
+    defer = 0;
+
+  error2 = OSS_SpinLockRelease(h->osHdl, g->slHdl);
+  if (error2)
+    {
+      DBGWRT_ERR((DBH, "*** BB - %s%s: OSS_SpinLockRelease() failed!"
+		  "Error 0x%0x\n", BBNAME, functionName, error2 ));
+      if( !error )
+	error = error2;
+    }
+
+  if( defer )
+    OSS_AlarmSet( h->osHdl, h->irqEnAlm, h->irqEnDefer, 0, &realMsec );
+
+  /* held off bits not released: try again later */
+  if( rearm )
+    OSS_AlarmSet( h->osHdl, h->irqModAlm, h->irqModHoldoff, 0, &realMsec );
+
+  return error;
+}
+
+/******************************* GirqInUseTake ******************************
+ *
+ *  Description: Take GIRQ INUSE hardware lock
+ *
+ *               The INUSE bit is 0 when no other master uses the IRQ_EN
+ *               register. While it is 1, the bit is polled with
+ *               exponential backoff (BBCHAM_GIRQ_INUSE_DLY_MIN..MAX us)
+ *               until the GIRQ_INUSE_TIMEOUT from the descriptor expires.
+ *               The INUSE bit is released by writing 1 to the register.
+ *
+ *               Must be called with spinlock held. Updates stats of the
+ *               shared GIRQ state.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   0 | ERR_OSS_TIMEOUT
+ *  Globals....: -
+ ****************************************************************************/
+static int32 GirqInUseTake( BBIS_HANDLE *h )	/* nodoc */
+{
+  DBGCMD(	static const char functionName[] = "_GirqInUseTake:"; )
+  u_int32 girqInUse;
+  u_int32 girqCount = 0;
+  u_int32 waited = 0;
+  u_int32 dly = BBCHAM_GIRQ_INUSE_DLY_MIN;
+  BBIS_CHAM_GIRQ *g = h->girq;
+
+  /* check INUSE bit */
+  _MREAD_D32(girqInUse, g->virtAddr, BBCHAM_GIRQ_IN_USE);
+#ifdef  _BIG_ENDIAN_
+  girqInUse = OSS_SWAP32( girqInUse );
+#endif
+
+  while ( (girqInUse & BBCHAM_GIRQ_IN_USE_BIT) )
+    {
+      if( waited >= h->girqInUseTout )
+	{
+	  g->stats.timeouts++;
+	  g->stats.waitTotal += waited;
+	  DBGWRT_ERR((DBH, "*** BB - %s%s: GIRQ INUSE bit not released "
+		      "within %dus\n", BBNAME, functionName, waited ));
+	  return ERR_OSS_TIMEOUT;
+	}
+
+      girqCount++;
+      DBGWRT_2((DBH, " GIRQ INUSE retry! count=%d\n",
+		girqCount ));
+
+      /* don't wait beyond timeout */
+      if( dly > h->girqInUseTout - waited )
+	dly = h->girqInUseTout - waited;
+
+      OSS_MikroDelay(h->osHdl, dly );
+      waited += dly;
+
+      if( dly < BBCHAM_GIRQ_INUSE_DLY_MAX )
+	dly <<= 1;
+
+      /* check INUSE bit */
+      _MREAD_D32(girqInUse, g->virtAddr, BBCHAM_GIRQ_IN_USE);
+#ifdef	_BIG_ENDIAN_
+      girqInUse = OSS_SWAP32( girqInUse );
+#endif
+    }
+
+  g->stats.acquired++;
+  if( girqCount ) {
+    g->stats.contended++;
+    g->stats.waitTotal += waited;
+    if( waited > g->stats.waitMax )
+      g->stats.waitMax = waited;
+  }
+
+  DBGWRT_1((DBH, "BB - %s%s: GIRQ INUSE bit taken. Retry count=%0d\n",
+	    BBNAME, functionName, girqCount ));
+
+  return 0;
+}
+
+/******************************* IrqEnableBlk *******************************
+ *
+ *  Description: Enable/disable interrupts of several slots at once
+ *
+ *               CHAMELEON_BLK_IRQ_EN:    data is CHAMELEON_IRQ_EN_BLK,
+ *                                        GIRQ bits to set and clear
+ *               CHAMELEON_BLK_IRQ_SLOTS: data is u_int32 array of slot
+ *                                        numbers, ORed with
+ *                                        CHAMELEON_IRQ_SLOT_EN to enable
+ *
+ *               Slots without interrupt are ignored, polled slots are
+ *               not enabled. The masks of CHAMELEON_BLK_IRQ_EN may only
+ *               contain GIRQ bits of slots of this handle (with lazy
+ *               enumeration: slots already looked up), other handles on
+ *               the same FPGA share the GIRQ.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               code       setstat code
+ *               blk        block setstat data
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IrqEnableBlk(
+			  BBIS_HANDLE *h,
+			  int32 code,
+			  M_SG_BLOCK *blk )	/* nodoc */
+{
+  u_int32 setMask[2] = { 0, 0 };
+  u_int32 clrMask[2] = { 0, 0 };
+  u_int32 ownMask[2] = { 0, 0 };
+  u_int32 pollMask[2] = { 0, 0 };
+  u_int32 *slots, slot, n;
+  BBIS_CHAM_IRQ *r;
+
+  if( blk->size < 0 )
+    return ERR_BBIS_ILL_PARAM;
+
+  if( !h->girq ) {
+    DBGWRT_ERR((DBH, "*** %s_SetStat: no GIRQ unit\n", BBNAME ));
+    return ERR_BBIS_ILL_FUNC;
+  }
+
+  if( code == CHAMELEON_BLK_IRQ_EN ) {
+    CHAMELEON_IRQ_EN_BLK *en = (CHAMELEON_IRQ_EN_BLK*)blk->data;
+
+    if( blk->size < (int32)sizeof(*en) )
+      return ERR_BBIS_ILL_PARAM;
+
+    /* GIRQ bits of own slots */
+    for( n=0; n < h->usedNum; n++ ) {
+      r = &h->irq[h->used[n]];
+      ownMask[r->offs / 4] |= r->mask;
+      if( r->flags & CHAM_IRQ_POLL )
+	pollMask[r->offs / 4] |= r->mask;
+    }
+
+    for( n=0; n < 2; n++ ) {
+      if( (en->setMask[n] | en->clrMask[n]) & ~ownMask[n] ) {
+	DBGWRT_ERR((DBH, "*** %s_SetStat: GIRQ bits %08x not of own slots\n",
+		    BBNAME, (en->setMask[n] | en->clrMask[n]) & ~ownMask[n] ));
+	return ERR_BBIS_ILL_IRQPARAM;
+      }
+      setMask[n] = en->setMask[n] & ~pollMask[n];
+      clrMask[n] = en->clrMask[n];
+    }
+  }
+  else {
+    slots = (u_int32*)blk->data;
+
+    for( n=0; n < (u_int32)blk->size / sizeof(u_int32); n++ ) {
+      slot = slots[n] & ~CHAMELEON_IRQ_SLOT_EN;
+
+      if( SlotUnused( h, slot ) ) {
+	DBGWRT_ERR((DBH, "*** %s_SetStat: slot %d not used\n",
+		    BBNAME, slot ));
+	return ERR_BBIS_ILL_IRQPARAM;
+      }
+
+      r = &h->irq[slot];
+      if( !r->mask )
+	continue;
+
+      if( slots[n] & CHAMELEON_IRQ_SLOT_EN ) {
+	if( !(r->flags & CHAM_IRQ_POLL) )
+	  setMask[r->offs / 4] |= r->mask;
+      }
+      else
+	clrMask[r->offs / 4] |= r->mask;
+    }
+  }
+
+  DBGWRT_2((DBH, " IrqEnableBlk: set %08x %08x clr %08x %08x\n",
+	    setMask[0], setMask[1], clrMask[0], clrMask[1] ));
+
+  return GirqUpdate( h, setMask, clrMask, GIRQ_UPD_ENABLE );
+}
+
+/******************************** IrqPending ********************************
+ *
+ *  Description: Get pending polled slots
+ *
+ *               Both halves of the GIRQ request register are read once,
+ *               the slots of IRQ_POLL_SLOTS with request bit set are
+ *               returned as u_int32 bitmap.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               blk        block getstat data
+ *  Output.....: returns:   error code
+ *               blk        bitmap of pending slots, size set to used size
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IrqPending( BBIS_HANDLE *h, M_SG_BLOCK *blk )	/* nodoc */
+{
+  u_int32 *pending = (u_int32*)blk->data;
+  u_int32 irqreq[2];
+  u_int32 words, s, slot;
+  BBIS_CHAM_IRQ *r;
+
+  if( !h->girq ) {
+    DBGWRT_ERR((DBH, "*** %s_GetStat: no GIRQ unit\n", BBNAME ));
+    return ERR_BBIS_ILL_FUNC;
+  }
+
+  if( blk->size < (int32)sizeof(u_int32) )
+    return ERR_BBIS_ILL_PARAM;
+
+  words = (h->slotNum + 31) / 32;
+  if( words > (u_int32)blk->size / sizeof(u_int32) )
+    words = (u_int32)blk->size / sizeof(u_int32);
+  OSS_MemFill( h->osHdl, words * sizeof(u_int32), (char*)pending, 0x00 );
+
+  GirqRegRead( h, BBCHAM_GIRQ_IRQ_REQ, 0, 2, irqreq );
+
+  for( s=0; s < h->usedNum; s++ ) {
+    slot = h->used[s];
+    r    = &h->irq[slot];
+
+    if( (r->flags & CHAM_IRQ_POLL) && slot < words * 32 &&
+	(irqreq[r->offs / 4] & r->mask) )
+      BITMAP_SET( pending, slot );
+  }
+
+  blk->size = words * sizeof(u_int32);
+  return ERR_SUCCESS;
+}
+
+/********************************* IrqOrder *********************************
+ *
+ *  Description: Get pending slots in dispatch order
+ *
+ *               Both halves of the GIRQ request register are read once.
+ *               The request bits are masked with the GIRQ bits of each
+ *               IRQ_PRIO level, highest first, and the set bits are
+ *               walked by counting trailing zeros. Within one level,
+ *               lower GIRQ bits come first. Slots sharing a GIRQ bit are
+ *               all reported, in slot order.
+ *
+ *               *_IrqSrvInit uses the same levels to answer the slots of
+ *               the highest pending level first, see IrqPrioAbove().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               blk        block getstat data
+ *  Output.....: returns:   error code
+ *               blk        u_int32 array of slots, size set to used size
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IrqOrder( BBIS_HANDLE *h, M_SG_BLOCK *blk )	/* nodoc */
+{
+  u_int32 *slots = (u_int32*)blk->data;
+  u_int32 irqreq[2], pend;
+  u_int32 max, n = 0;
+  u_int16 s;
+  int prio, half;
+
+  if( !h->girq ) {
+    DBGWRT_ERR((DBH, "*** %s_GetStat: no GIRQ unit\n", BBNAME ));
+    return ERR_BBIS_ILL_FUNC;
+  }
+
+  if( blk->size < 0 )
+    return ERR_BBIS_ILL_PARAM;
+
+  max = (u_int32)blk->size / sizeof(u_int32);
+
+  GirqRegRead( h, BBCHAM_GIRQ_IRQ_REQ, 0, 2, irqreq );
+
+  for( prio=0; prio < CHAM_IRQ_PRIO_NUM; prio++ ) {
+    for( half=0; half < 2; half++ ) {
+      pend = irqreq[half] & h->irqPrioMask[prio][half];
+
+      for( ; pend && n < max; pend &= pend - 1 ) {
+	for( s = h->irqBitSlot[half * 32 + CTZ32(pend)];
+	     s != CHAMELEON_NO_SLOT && n < max; s = h->irqBitNext[s] )
+	  if( SLOT_PRIO(h,s) == prio )
+	    slots[n++] = s;
+      }
+    }
+  }
+
+  blk->size = n * sizeof(u_int32);
+  return ERR_SUCCESS;
+}
+
+/******************************** IrqPendMap ********************************
+ *
+ *  Description: Get RAM copy of the GIRQ request register
+ *
+ *               The CHAMELEON_IRQ_PEND is allocated on first call, in a
+ *               cache line of its own. From then on *_IrqSrvInit reads
+ *               both halves of IRQ_REQ and stores them there at each
+ *               call. In its interrupt routine, a
+ *               child driver can check bit (interrupt & 31) of
+ *               req[interrupt >> 5] (interrupt from MDIS_MA_BB_INFO_PTR)
+ *               with a RAM load instead of reading its unit over the bus.
+ *               Outside of interrupt routines the data may be stale.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *               mAddr      CHAMELEON_IRQ_PEND
+ *               mSize      size of CHAMELEON_IRQ_PEND
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IrqPendMap(
+			BBIS_HANDLE *h,
+			void **mAddr,
+			u_int32 *mSize )	/* nodoc */
+{
+  if( !h->girq ) {
+    DBGWRT_ERR((DBH,"*** %s_GetMAddr: no GIRQ unit\n", BBNAME ));
+    return ERR_BBIS_ILL_ADDRMODE;
+  }
+
+  if( !h->irqPendMem ) {
+    h->irqPendMem = OSS_MemGet( h->osHdl, 2 * CHAM_CACHE_LINE,
+				&h->irqPendGotSize );
+    if( !h->irqPendMem ) {
+      DBGWRT_ERR((DBH, "*** %s_GetMAddr: no ressources\n", BBNAME));
+      return ERR_OSS_MEM_ALLOC;
+    }
+    OSS_MemFill( h->osHdl, 2 * CHAM_CACHE_LINE, (char*)h->irqPendMem, 0x00 );
+
+    h->irqPend = (CHAMELEON_IRQ_PEND*)
+      (((U_INT32_OR_64)h->irqPendMem + CHAM_CACHE_LINE - 1) &
+       ~(U_INT32_OR_64)(CHAM_CACHE_LINE - 1));
+  }
+
+  *mAddr = h->irqPend;
+  *mSize = sizeof(CHAMELEON_IRQ_PEND);
+
+  DBGWRT_2((DBH, " IRQ_REQ published at %08p\n", *mAddr ));
+  return ERR_SUCCESS;
+}
+
+/******************************* IrqModerate ********************************
+ *
+ *  Description: Count interrupt of moderated slot
+ *
+ *               Called from *_IrqSrvInit for interrupts of IRQ_MOD_SLOTS.
+ *               When IRQ_MOD_COUNT interrupts occur within IRQ_MOD_WINDOW,
+ *               the slot's GIRQ bit is cleared and IrqModAlarm() sets it
+ *               again after IRQ_MOD_HOLDOFF.
+ *
+ *               Runs in interrupt context: the bit is cleared with one
+ *               write of IRQ_EN. With GIRQ API version, the INUSE lock is
+ *               tried once without waiting. When another master holds it,
+ *               the slot is held off at its next interrupt instead.
+ *               The holdoff alarm is armed here, after the GIRQ spinlock
+ *               is released. This needs an OSS_AlarmSet() that may be
+ *               called in interrupt context, see CHAM_IRQ_MOD_SUPP.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               r          interrupt routing of slot
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqModerate( BBIS_HANDLE *h, BBIS_CHAM_IRQ *r )	/* nodoc */
+{
+  BBIS_CHAM_GIRQ *g = h->girq;
+  u_int32 tick = OSS_TickGet( h->osHdl );
+  u_int32 irqen[2];
+  u_int32 girqInUse;
+  u_int32 realMsec;
+  int half = r->offs / 4;
+  int num, arm = 0;
+
+  if( OSS_SpinLockAcquire( h->osHdl, g->slHdl ) )
+    return;
+
+  /* new window? */
+  if( tick - r->modStart >= h->irqModWinTicks ) {
+    r->modStart = tick;
+    r->modCnt   = 0;
+  }
+
+  if( ++r->modCnt < h->irqModCount )
+    goto UNLOCK;
+
+  num = GIRQ_ACC_HALVES(g);
+  if( num == 2 )
+    half = 0;
+
+  /* no concurrent GIRQ writer: clear bit in shadow, one write */
+  if( !g->apiVersion ) {
+    g->en[r->offs / 4] &= ~r->mask;
+    GirqRegWrite( h, BBCHAM_GIRQ_IRQ_EN, half, num, g->en );
+  }
+  else {
+    /* try INUSE once, reading 0 takes it */
+    _MREAD_D32(girqInUse, g->virtAddr, BBCHAM_GIRQ_IN_USE);
+#ifdef  _BIG_ENDIAN_
+    girqInUse = OSS_SWAP32( girqInUse );
+#endif
+    if( girqInUse & BBCHAM_GIRQ_IN_USE_BIT ) {
+      IDBGWRT_2((DBH, " IrqModerate: GIRQ INUSE busy, hold off later\n"));
+      goto UNLOCK;
+    }
+    g->stats.acquired++;
+
+    GirqRegRead( h, BBCHAM_GIRQ_IRQ_EN, half, num, irqen );
+    irqen[r->offs / 4] &= ~r->mask;
+    GirqRegWrite( h, BBCHAM_GIRQ_IRQ_EN, half, num, irqen );
+    g->en[r->offs / 4] = irqen[r->offs / 4];
+
+    girqInUse = BBCHAM_GIRQ_IN_USE_BIT;
+#ifdef _BIG_ENDIAN_
+    girqInUse = OSS_SWAP32( girqInUse );
+#endif
+    _MWRITE_D32(g->virtAddr, BBCHAM_GIRQ_IN_USE, girqInUse);
+  }
+
+  /* too many interrupts: slot held off */
+  IDBGWRT_2((DBH, " IrqModerate: hold off GIRQ bit %08x+%d\n",
+	     r->mask, r->offs ));
+
+  h->girqHeld[r->offs / 4] |= r->mask;
+  g->held[r->offs / 4]     |= r->mask;
+  r->modCnt = 0;
+
+  if( !h->irqModArmed )
+    arm = h->irqModArmed = 1;
+
+ UNLOCK:
+  OSS_SpinLockRelease( h->osHdl, g->slHdl );
+
+  if( arm )
+    OSS_AlarmSet( h->osHdl, h->irqModAlm, h->irqModHoldoff, 0, &realMsec );
+}
+
+/******************************* IrqModAlarm ********************************
+ *
+ *  Description: Re-enable slots held off by interrupt moderation
+ *
+ *               Only bits that are still enabled by the drivers are set.
+ *               GirqUpdate() clears irqModArmed with the release and sets
+ *               the alarm again when the GIRQ INUSE lock times out.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg        handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqModAlarm( void *arg )	/* nodoc */
+{
+  BBIS_HANDLE *h = (BBIS_HANDLE*)arg;
+  u_int32 setMask[2] = { 0, 0 };
+  u_int32 clrMask[2] = { 0, 0 };
+
+  if( h->girq )
+    GirqUpdate( h, setMask, clrMask, GIRQ_UPD_RELEASE );
+}
+
+/********************************* GirqFlush ********************************
+ *
+ *  Description: Write deferred interrupt enables
+ *
+ *               Pending enables of all handles on the GIRQ unit are
+ *               written with one lock/INUSE handshake. Nothing is done
+ *               when no enable is pending.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 GirqFlush( BBIS_HANDLE *h )	/* nodoc */
+{
+  u_int32 setMask[2] = { 0, 0 };
+  u_int32 clrMask[2] = { 0, 0 };
+
+  return GirqUpdate( h, setMask, clrMask, GIRQ_UPD_FLUSH );
+}
+
+/******************************** IrqEnAlarm ********************************
+ *
+ *  Description: Write interrupt enables deferred by IRQ_EN_DEFER
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg        handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void IrqEnAlarm( void *arg )	/* nodoc */
+{
+  BBIS_HANDLE *h = (BBIS_HANDLE*)arg;
+
+  if( !h->girq )
+    return;
+
+  /* deferred enables from now on set the alarm again */
+  if( OSS_SpinLockAcquire( h->osHdl, h->girq->slHdl ) == ERR_SUCCESS ) {
+    h->irqEnArmed = 0;
+    OSS_SpinLockRelease( h->osHdl, h->girq->slHdl );
+  }
+
+  /* GIRQ INUSE timeout: GirqUpdate() starts alarm again */
+  GirqFlush( h );
+}
+
+/******************************* TblUnchanged *******************************
+ *
+ *  Description: Check if the chameleon table matches the fingerprint of
+ *               the last successful *_BrdInit call
+ *
+ *               The unit count is checked without reading the whole table:
+ *               the last unit of the previous table must exist and must be
+ *               followed by the table end.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               chamHdl    chameleon handle
+ *               tbl        current table ident
+ *  Output.....: returns:   TRUE if unchanged
+ *  Globals....: -
+ ****************************************************************************/
+static int32 TblUnchanged(
+			  BBIS_HANDLE *h,
+			  CHAMELEONV2_HANDLE *chamHdl,
+			  CHAMELEONV2_TABLE *tbl )	/* nodoc */
+{
+  CHAMELEONV2_UNIT unit;
+
+  if( tbl->model != h->fpTbl.model ||
+      tbl->revision != h->fpTbl.revision ||
+      OSS_StrCmp( h->osHdl, tbl->file, h->fpTbl.file ) )
+    return FALSE;
+
+  if( h->chamFuncTbl[h->tblType].UnitIdent( chamHdl, h->fpUnitNum - 1,
+					    &unit ) != CHAMELEON_OK ||
+      h->chamFuncTbl[h->tblType].UnitIdent( chamHdl, h->fpUnitNum,
+					    &unit ) != CHAMELEONV2_NO_MORE_ENTRIES )
+    return FALSE;
+
+  return TRUE;
+}
+
+/******************************* UnitArenaWalk ******************************
+ *
+ *  Description: Walk over the unit info pointers of all slots and group
+ *               members
+ *
+ *               Pointers of unusable slots are cleared. If arena is given,
+ *               the unit info is copied into arena and the pointers are
+ *               redirected to the copy.
+ *               Groups are recognized by devGotSize[] != 0 as their
+ *               devId[] entry may have been set to CHAMELEON_NO_DEV.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               arena      destination of unit info or NULL
+ *  Output.....: returns:   number of units referenced
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 UnitArenaWalk( BBIS_HANDLE *h, CHAMELEONV2_UNIT *arena )	/* nodoc */
+{
+  BBIS_CHAM_GRP *lGrp;
+  void **unitPP;
+  u_int32 s, i, num = 0;
+  int32 n, nMax;
+
+  for( s=0; s < h->usedNum; s++ ){
+    i = h->used[s];
+    if( !h->dev[i] )
+      continue;
+
+    if( h->devGotSize[i] ){
+      lGrp   = (BBIS_CHAM_GRP*)h->dev[i];
+      unitPP = lGrp->dev;
+      nMax   = lGrp->devCount;
+    } else {
+      unitPP = &h->dev[i];
+      nMax   = 1;
+    }
+
+    for( n=0; n < nMax; n++ ){
+      if( !unitPP[n] )
+	continue;
+
+      if( h->devId[i] == CHAMELEON_NO_DEV ) {
+	unitPP[n] = NULL;
+      } else {
+	if( arena ) {
+	  OSS_MemCopy( h->osHdl, sizeof( CHAMELEONV2_UNIT ),
+		       (char*)unitPP[n], (char*)&arena[num] );
+	  unitPP[n] = &arena[num];
+	}
+	num++;
+      }
+    }
+  }
+
+  return num;
+}
+
+/****************************** UnitArenaBuild ******************************
+ *
+ *  Description: Copy the unit info of all slots and group members into
+ *               one memory block
+ *
+ *               Before, the slots reference the units of the table snapshot.
+ *               A unit arena of a previous BrdInit call is released.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: returns:   error code
+ *  Globals....: -
+ ****************************************************************************/
+static int32 UnitArenaBuild( BBIS_HANDLE *h )	/* nodoc */
+{
+  u_int32 num;
+
+  if( h->unitArena ) {
+    OSS_MemFree( h->osHdl, h->unitArena, h->unitArenaGotSize );
+    h->unitArena = NULL;
+  }
+
+  /* count units, get memory for all of them at once */
+  if( (num = UnitArenaWalk( h, NULL )) == 0 )
+    return ERR_SUCCESS;
+
+  h->unitArena = (CHAMELEONV2_UNIT*)OSS_MemGet( h->osHdl,
+						num * sizeof(CHAMELEONV2_UNIT),
+						&h->unitArenaGotSize );
+  if( !h->unitArena ) {
+    DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources f. %d chamUnits\n",
+		BBNAME, num));
+    return ERR_OSS_MEM_ALLOC;
+  }
+
+  UnitArenaWalk( h, h->unitArena );
+  return ERR_SUCCESS;
+}
+
+/******************************* UnitArenaFree ******************************
+ *
+ *  Description: Clear all unit info pointers and release the unit arena
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void UnitArenaFree( BBIS_HANDLE *h )	/* nodoc */
+{
+  BBIS_CHAM_GRP *lGrp;
+  u_int32 s, i;
+  int32 n;
+
+  for( s=0; s < h->usedNum; s++ ){
+    i = h->used[s];
+    if( !h->dev[i] )
+      continue;
+
+    if( h->irq[i].mask )
+      IrqBitDel( h, i );
+    OSS_MemFill( h->osHdl, sizeof(BBIS_CHAM_IRQ), (char*)&h->irq[i], 0x00 );
+
+    if( h->devGotSize[i] ){
+      lGrp = (BBIS_CHAM_GRP*)h->dev[i];
+      for( n=0; n < lGrp->devCount; n++ )
+	lGrp->dev[n] = NULL;
+    } else {
+      h->dev[i] = NULL;
+    }
+  }
+
+  if( h->unitArena ) {
+    OSS_MemFree( h->osHdl, h->unitArena, h->unitArenaGotSize );
+    h->unitArena = NULL;
+  }
+}
+
+/********************************* SnapRead *********************************
+ *
+ *  Description: Read all units of the chameleon table into RAM
+ *
+ *               Each unit is read once with UnitIdent(). Afterwards an index
+ *               sorted by devId/group is built, so that SnapFind() does not
+ *               need to walk the whole table for each lookup. Units with
+ *               equal devId/group keep their table order within the index.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               chamHdl    chameleon handle
+ *  Output.....: returns:   error code
+ *               *snap      table snapshot (free with SnapFree())
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SnapRead(
+		      BBIS_HANDLE *h,
+		      CHAMELEONV2_HANDLE *chamHdl,
+		      BBIS_CHAM_SNAP *snap )	/* nodoc */
+{
+  CHAMELEONV2_UNIT *newUnit;
+  u_int32 maxNum = 0, gotSize, i, n, key;
+  int32 chErr;
+
+  for( snap->num=0; ; snap->num++ ){
+
+    /* snapshot full? get a bigger one */
+    if( snap->num == maxNum ){
+      maxNum += CHAM_SNAP_CHUNK;
+      newUnit = (CHAMELEONV2_UNIT*)OSS_MemGet( h->osHdl,
+					       maxNum * sizeof(CHAMELEONV2_UNIT),
+					       &gotSize );
+      if( !newUnit ){
+	DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources f. table snapshot\n",
+		    BBNAME));
+	return ERR_OSS_MEM_ALLOC;
+      }
+      if( snap->unit ){
+	OSS_MemCopy( h->osHdl, snap->num * sizeof(CHAMELEONV2_UNIT),
+		     (char*)snap->unit, (char*)newUnit );
+	OSS_MemFree( h->osHdl, snap->unit, snap->unitGotSize );
+      }
+      snap->unit        = newUnit;
+      snap->unitGotSize = gotSize;
+    }
+
+    chErr = h->chamFuncTbl[h->tblType].UnitIdent( chamHdl, snap->num,
+						  &snap->unit[snap->num] );
+    /* no unit? => leave loop */
+    if( chErr == CHAMELEONV2_NO_MORE_ENTRIES )
+      break;
+
+    if( chErr != CHAMELEON_OK ){
+      DBGWRT_ERR((DBH, "*** %s_BrdInit: CHAM_UnitIdent error 0x%x!\n",
+		  BBNAME, chErr));
+      return ERR_BBIS;
+    }
+  }
+
+  DBGWRT_2((DBH, " table snapshot: %d units\n", snap->num));
+
+  if( snap->num == 0 )
+    return ERR_SUCCESS;
+
+  /* build index sorted by devId/group (stable insertion sort) */
+  snap->index = (u_int16*)OSS_MemGet( h->osHdl, snap->num * sizeof(u_int16),
+				      &snap->indexGotSize );
+  if( !snap->index ){
+    DBGWRT_ERR((DBH, "*** %s_BrdInit: no ressources f. table snapshot\n",
+		BBNAME));
+    return ERR_OSS_MEM_ALLOC;
+  }
+
+  for( i=0; i < snap->num; i++ ){
+    key = SNAP_KEY( &snap->unit[i] );
+    for( n=i; n > 0 && SNAP_KEY( &snap->unit[snap->index[n-1]] ) > key; n-- )
+      snap->index[n] = snap->index[n-1];
+    snap->index[n] = (u_int16)i;
+  }
+
+  return ERR_SUCCESS;
+}
+
+/********************************* SnapFind *********************************
+ *
+ *  Description: Find a unit in the table snapshot
+ *
+ *               Same matching as InstanceFind() of the chameleon library:
+ *               The idx-th unit (in table order) which matches all fields
+ *               of *find that are not -1 is returned.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: snap       table snapshot
+ *               idx        index of matching unit
+ *               find       search criteria
+ *  Output.....: returns:   CHAMELEONV2_UNIT_FOUND | CHAMELEONV2_NO_MORE_ENTRIES
+ *               *unitP     unit within snapshot
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SnapFind(
+		      BBIS_CHAM_SNAP *snap,
+		      int32 idx,
+		      CHAMELEONV2_FIND *find,
+		      CHAMELEONV2_UNIT **unitP )	/* nodoc */
+{
+  CHAMELEONV2_UNIT *u;
+  u_int32 lo = 0, hi = snap->num, mid, key = 0, n;
+  int useIndex = ( find->devId != -1 && find->group != -1 );
+
+  if( useIndex ){
+    /* lower bound of devId/group in index */
+    key = ((u_int32)find->devId << 16) | (u_int16)find->group;
+    while( lo < hi ){
+      mid = (lo + hi) / 2;
+      if( SNAP_KEY( &snap->unit[snap->index[mid]] ) < key )
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+    hi = snap->num;
+  }
+
+  for( n=lo; n < hi; n++ ){
+    u = useIndex ? &snap->unit[snap->index[n]] : &snap->unit[n];
+
+    if( useIndex && SNAP_KEY( u ) != key )
+      break;
+
+    if( (find->devId    != -1 && find->devId    != u->devId)    ||
+	(find->variant  != -1 && find->variant  != u->variant)  ||
+	(find->instance != -1 && find->instance != u->instance) ||
+	(find->busId    != -1 && find->busId    != (int32)u->busId) ||
+	(find->group    != -1 && find->group    != u->group) )
+      continue;
+
+    if( idx-- == 0 ){
+      *unitP = u;
+      return CHAMELEONV2_UNIT_FOUND;
+    }
+  }
+
+  return CHAMELEONV2_NO_MORE_ENTRIES;
+}
+
+/********************************* SnapFree *********************************
+ *
+ *  Description: Release table snapshot
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: h          handle
+ *               snap       table snapshot
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void SnapFree( BBIS_HANDLE *h, BBIS_CHAM_SNAP *snap )	/* nodoc */
+{
+  if( snap->index )
+    OSS_MemFree( h->osHdl, snap->index, snap->indexGotSize );
+  if( snap->unit )
+    OSS_MemFree( h->osHdl, snap->unit, snap->unitGotSize );
+  snap->index = NULL;
+  snap->unit  = NULL;
+  snap->num   = 0;
+}
+
 #ifndef CHAM_ISA
 /********************************* ParsePciPath *****************************
  *
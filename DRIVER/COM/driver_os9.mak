@@ -38,6 +38,7 @@ MAK_SWITCH=	 	  \
 		$(SW_PREFIX)$(DEF_REVISION)
 
 MAK_INCL=$(MEN_INC_DIR)/bb_chameleon.h	\
+		 $(MEN_INC_DIR)/bb_chameleon_drv.h	\
 		 $(MEN_INC_DIR)/bb_defs.h	\
 		 $(MEN_INC_DIR)/bb_entry.h	\
 		 $(MEN_INC_DIR)/dbg.h		\
@@ -41,6 +41,7 @@ MAK_SWITCH=$(SW_PREFIX)CHAMELEON_USE_PCITABLE \
 	   $(SW_PREFIX)CHAMELEON_USE_A21_MSI
 
 MAK_INCL=$(MEN_INC_DIR)/bb_chameleon.h	\
+	 $(MEN_INC_DIR)/bb_chameleon_drv.h	\
 	 $(MEN_INC_DIR)/bb_defs.h	\
 	 $(MEN_INC_DIR)/bb_entry.h	\
 	 $(MEN_INC_DIR)/dbg.h		\
@@ -0,0 +1,82 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: bb_chameleon_drv.h
+ *      Project: CHAMELEON board handler
+ *
+ *  Description: Board specific status codes, address modes and data
+ *               structures of the CHAMELEON BBIS driver
+ *
+ *               For applications (M_setstat/M_getstat) and child
+ *               drivers (GetMAddr, SetStat and GetStat of the board
+ *               handler). Needs men_typs.h and mdis_api.h.
+ *
+ *     Switches: ---
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BB_CHAMELEON_DRV_H
+#define _BB_CHAMELEON_DRV_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/* board specific status codes */
+#define CHAMELEON_IRQ_EN_FLUSH		(M_BRD_OF+0x00)		/* write deferred enables */
+#define CHAMELEON_BLK_IRQ_EN		(M_BRD_BLK_OF+0x00)	/* set/clear GIRQ bits */
+#define CHAMELEON_BLK_IRQ_SLOTS		(M_BRD_BLK_OF+0x01)	/* en/disable slot list */
+#define CHAMELEON_IRQ_SLOT_EN		0x80000000	/* slot list: enable flag */
+#define CHAMELEON_BLK_GIRQ_STATS	(M_BRD_BLK_OF+0x02)	/* GIRQ INUSE statistics */
+#define CHAMELEON_BLK_IRQ_PENDING	(M_BRD_BLK_OF+0x03)	/* pending polled slots */
+#define CHAMELEON_BLK_IRQ_ORDER		(M_BRD_BLK_OF+0x04)	/* pending slots by priority */
+
+/* board specific address modes */
+#define CHAMELEON_MA_IRQ_PEND		0x1000		/* RAM copy of GIRQ IRQ_REQ */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* CHAMELEON_BLK_IRQ_EN setstat data */
+typedef struct {
+	u_int32	setMask[2];			/* GIRQ bits to enable (lower/upper) */
+	u_int32	clrMask[2];			/* GIRQ bits to disable (lower/upper) */
+} CHAMELEON_IRQ_EN_BLK;
+
+/* CHAMELEON_MA_IRQ_PEND data, in a cache line of its own */
+typedef struct {
+	u_int32	req[2];				/* IRQ_REQ (lower/upper) at last read */
+} CHAMELEON_IRQ_PEND;
+
+/* CHAMELEON_BLK_GIRQ_STATS getstat data, wait times in us */
+typedef struct {
+	u_int32	acquired;			/* INUSE lock acquisitions */
+	u_int32	contended;			/* acquisitions that had to wait */
+	u_int32	timeouts;			/* acquisitions failed by timeout */
+	u_int32	waitTotal;			/* total wait time */
+	u_int32	waitMax;			/* max wait time of one acquisition */
+} CHAMELEON_GIRQ_STATS;
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* _BB_CHAMELEON_DRV_H */